@@ -1,6 +1,23 @@
 // compile with: clang++ -std=c++20 -Wall -Werror -Wextra -Wpedantic -g3 -o team23-typespeed team23-typespeed.cpp
 // run with: ./team23-typespeed 2> /dev/null
 // run with: ./team23-typespeed 2> debugoutput.txt
+// build the binary word list with: ./team23-typespeed --compile-dictionary wordlist.txt wordlist.tsd
+// (the game loads wordlist.tsd when it's there, otherwise it reads wordlist.txt)
+// host many games at once with: ./team23-typespeed --server /tmp/typespeed.sock [threads]
+// (or give a port number instead of a path for TCP), then play with: nc -U /tmp/typespeed.sock
+// cap how often the screen is redrawn with: ./team23-typespeed --fps 30 (the game runs at the same speed either way)
+// play another mode (sprint, marathon, hardcore or zen) with: ./team23-typespeed --mode <name>
+// measure the game engine without a terminal with: ./team23-typespeed --benchmark [ticks] [seed] [mode]
+// (compile with -DTYPESPEED_COUNT_ALLOCATIONS to have the benchmarks count allocations too)
+// time keypresses end to end with: ./team23-typespeed --latency-benchmark [keystrokes]
+// compare the escape code tables with the old MakeColour / MoveTo path with: ./team23-typespeed --escape-benchmark [words]
+// check the high score ranks against a plain walk down the table with: ./team23-typespeed --ranking-check [players] [seed]
+// check which typed words and commands clear what with: ./team23-typespeed --typing-check
+// see how the move and clear phases scale over threads with: ./team23-typespeed --tick-scaling-benchmark [words] [threads]
+// every game is recorded to lastgame.tsr, play it back (and check it) with: ./team23-typespeed --replay lastgame.tsr [realtime|snapshots]
+// games are saved to lastgame.tss as they go (and when paused or quit), carry on from one with: ./team23-typespeed --resume [file]
+// record a timeline (open it in ui.perfetto.dev) with: TYPESPEED_TRACE=trace.json ./team23-typespeed 2> debugoutput.txt
+// let others watch with: TYPESPEED_BROADCAST=/tmp/typespeed-watch.sock ./team23-typespeed, then: nc -U /tmp/typespeed-watch.sock
 // "2>" redirect standard error (STDERR; cerr)
 // /dev/null is a "virtual file" which discard contents
 // Works best in Visual Studio Code if you set:
@@ -12,12 +29,54 @@
 #include <string>
 #include <random>
 #include <map>
+#include <unordered_map>
 #include <chrono>    // for dealing with time intervals
 #include <cmath>     // for max() and min()
 #include <termios.h> // to control terminal modes
 #include <unistd.h>  // for read()
 #include <fcntl.h>   // to enable / disable non-blocking read()
 #include <fstream>
+#include <algorithm> // for fill()
+#include <cerrno>    // to check why write() failed
+#include <cstdint>   // for uint64_t
+#include <array>
+#include <atomic>    // for the lock-free input ring
+#include <cstdlib>   // for llabs()
+#include <poll.h>    // to sleep until there is input or a tick is due
+#include <sys/timerfd.h> // kernel timer that becomes readable every tick
+#include <sys/mman.h>    // to map the word list straight into memory
+#include <sys/stat.h>    // for the size of the word list file
+#include <sys/file.h>    // for flock(), other processes can share the high score files
+#include <cstring>       // for memchr()
+#include <string_view>
+#include <set>
+#include <charconv>      // for from_chars(), parses scores without throwing
+#include <bit>           // for countr_zero(), finds free lanes
+#include <climits>       // for UINT_MAX
+#include <memory>
+#include <sstream>
+#include <deque>
+#include <thread>             // server mode runs sessions on a pool of threads
+#include <mutex>
+#include <condition_variable>
+#include <csignal>            // to shut the server down cleanly on ctrl-c
+#include <cstdio>             // for snprintf()
+#include <pty.h>              // for forkpty(), the latency benchmark runs the game in a pseudo terminal
+#include <sys/wait.h>
+#include <sys/ioctl.h>        // for TIOCGWINSZ, reads the terminal size without asking the terminal
+#include <filesystem>
+#include <sys/epoll.h>        // server mode watches every client socket at once
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>      // for TCP_NODELAY
+#include <sys/eventfd.h>      // wakes the spectator thread when there's a new frame
+#include <sys/uio.h>          // for struct iovec, sends several frames in one call
+#include <ext/pb_ds/assoc_container.hpp> // order-statistic tree, finds the n'th of the players on one score
+#include <ext/pb_ds/tree_policy.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>        // checks word lists for non-ASCII 16 bytes at a time
+#endif
 
 // Because we are only using #includes from the standard, names shouldn't conflict
 using namespace std;
@@ -64,6 +123,20 @@ const unsigned short MOVING_DOWN{4};
 const int YELLOW_STAGE_START{30}; //where the words start turning yellow
 const int RED_STAGE_START{50};    //col num of where it turns red
 
+const unsigned int COLOUR_TYPED{COLOUR_CYAN}; // part of a word the user has already typed
+
+const int BORDER_WIDTH{70};  // columns taken up by the play area box on the smallest terminal we allow
+const int BORDER_HEIGHT{32}; // rows taken up by the play area box on the smallest terminal we allow
+const int ROWS_BELOW_FIELD{3}; // a blank row, the command and the stats
+
+// The game moves on in fixed steps, however often the screen is redrawn
+const int SIMULATION_STEP_MS{25};
+const int SUBCELL_BITS{8}; // word positions are fixed point, in 256ths of a column
+const int BASE_WORD_SPEED{(1 << SUBCELL_BITS) * SIMULATION_STEP_MS / 100}; // a column every 100ms, the original speed
+const unsigned int SPAWN_INTERVAL_STEPS{1500 / SIMULATION_STEP_MS};      // a new word every 1.5s
+const unsigned int MAX_CATCH_UP_STEPS{8}; // after a stall, any more steps than this are dropped rather than rushed through
+const int DEFAULT_FRAME_RATE{60};
+
 //ends the stop warning, so only variables inbetween this pragma and that one
 #pragma clang diagnostic pop
 
@@ -73,16 +146,135 @@ struct positionStruct
     int col;
 };
 
-// add speed, moving property later?
-struct word
+// Dictionaries come either from a text file (one word per line, optionally followed
+// by a tab and a difficulty) or from the compiled .tsd format written by
+// --compile-dictionary. Either way the file is memory mapped and words are looked up
+// through the same tables; for a compiled file those tables point straight into the
+// mapping, for a text file they're built once at load time. Nothing else ever copies
+// the words, so the file has to stay mapped until the game is over.
+
+const char DICTIONARY_MAGIC[4]{'T', 'S', 'P', 'D'};
+const uint32_t DICTIONARY_VERSION{3}; // 2 added each word's width and code point count, 3 the checksum
+const unsigned int DIFFICULTY_LEVELS{3}; // 0 = easy, 1 = medium, 2 = hard
+
+// stored in the compiled file exactly as laid out here
+// (worked out once at load time, so nothing has to measure a word again while it's on screen)
+struct dictionaryEntry
+{
+    uint16_t length; // in bytes
+    uint8_t difficulty;
+    uint8_t width;       // columns it takes up on screen
+    uint16_t codePoints; // what it scores by
+    uint16_t reserved;
+};
+
+static_assert(sizeof(dictionaryEntry) == 8);
+
+// first thing in a compiled dictionary, all the ...Start values are byte offsets from the start of the file
+struct dictionaryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t wordCount;
+    uint32_t maxLength;
+    uint32_t difficultyLevels;
+    uint32_t textSize;
+    uint32_t offsetsStart;          // wordCount uint32s: where each word starts in the text
+    uint32_t entriesStart;          // wordCount dictionaryEntry
+    uint32_t lengthStartsStart;     // maxLength + 2 uint32s: where each length's bucket starts in byLength
+    uint32_t byLengthStart;         // wordCount uint32s: word numbers grouped by length
+    uint32_t difficultyStartsStart; // difficultyLevels + 1 uint32s: same idea for difficulty
+    uint32_t byDifficultyStart;     // wordCount uint32s
+    uint32_t textStart;             // every word back to back, no separators
+    uint32_t reserved;
+    uint64_t fingerprint; // DictionaryFingerprint of the words, so loading doesn't have to hash them
+    uint64_t checksum;    // DictionaryChecksum of everything after the header
+};
+
+static_assert(sizeof(dictionaryHeader) == 72);
+
+struct dictionary
+{
+    const char *data{nullptr}; // start of the mapped file
+    size_t size{0};
+    const char *text{nullptr}; // offsets are counted from here
+    unsigned int wordCount{0};
+    unsigned int maxLength{0}; // in code points, like the length buckets
+    const uint32_t *offsets{nullptr};
+    const dictionaryEntry *entries{nullptr};
+    const uint32_t *lengthStarts{nullptr};
+    const uint32_t *byLength{nullptr};
+    const uint32_t *difficultyStarts{nullptr};
+    const uint32_t *byDifficulty{nullptr};
+    // backing storage for the tables above when they were built from a text file
+    vector<uint32_t> ownedOffsets;
+    vector<dictionaryEntry> ownedEntries;
+    vector<uint32_t> ownedLengthStarts;
+    vector<uint32_t> ownedByLength;
+    vector<uint32_t> ownedDifficultyStarts;
+    vector<uint32_t> ownedByDifficulty;
+    uint64_t fingerprint{0}; // DictionaryFingerprint, worked out once when it's loaded
+};
+
+// The active words are kept as a structure of arrays: word i is at index i of every
+// array, so each per-tick loop only walks the properties it actually uses. The arrays
+// are sized once up front and never reallocate; removing words shuffles the survivors
+// down in a single pass, keeping them in the order they were created.
+struct wordStore
 {
-    string content;
-    positionStruct position;
-    bool cleared;
-    unsigned int colour;
+    unsigned int count{0};    // number of live words (the first count slots of each array)
+    unsigned int capacity{0}; // the most words that can be on screen at once
+    vector<string_view> content; // points at the entry in the dictionary, never a copy
+    vector<int> length;          // content.length(), so the hot loops don't have to touch the strings
+    vector<int> width;           // columns on screen, from the dictionary entry
+    vector<int> codePoints;      // from the dictionary entry too
+    vector<int> row;
+    vector<int> col;
+    vector<int> position; // col in 256ths (see SUBCELL_BITS), so slow words can move less than a column a step
+    vector<int> speed;    // added to position every simulation step
+    vector<unsigned int> colour;
+    vector<unsigned char> cleared; // not vector<bool>, so each flag is its own byte
+    vector<unsigned int> bornTick; // the tick the word appeared on
 };
 
-typedef vector<word> wordvector;
+const unsigned int WORD_STORE_CAPACITY{4096};
+
+// where everything goes on screen, worked out from the terminal size by ComputeLayout
+// (so bigger terminals get a bigger play area) and redone whenever the terminal is resized
+struct playLayout
+{
+    int fieldWidth;  // columns taken up by the play area box, words stop at fieldWidth - their length
+    int fieldHeight; // rows taken up by the box, words move along rows 2 to fieldHeight - 1
+    int yellowStart; // column where the words start turning yellow
+    int redStart;    // column where they turn red
+    int commandRow;
+    int statsRow;
+};
+
+auto ComputeLayout(int rows, int cols) -> playLayout
+{
+    playLayout layout;
+    // never smaller than a few words' worth, even if the terminal is shrunk mid game (it just gets clipped)
+    layout.fieldWidth = max(cols, 20);
+    layout.fieldHeight = max(rows - ROWS_BELOW_FIELD, 4);
+    // the colour stages stay at the same fraction of the way across as on a 70 column field
+    layout.yellowStart = YELLOW_STAGE_START * layout.fieldWidth / BORDER_WIDTH;
+    layout.redStart = RED_STAGE_START * layout.fieldWidth / BORDER_WIDTH;
+    layout.commandRow = layout.fieldHeight + 1;
+    layout.statsRow = layout.fieldHeight + ROWS_BELOW_FIELD;
+    return layout;
+}
+// word content -> indexes of the active words showing it, so a match is one hash lookup
+// (keys are views into the dictionary, so adding a word never copies its text)
+typedef unordered_map<string_view, vector<unsigned int>> wordlookup;
+
+// follows the user's typing one key at a time
+struct prefixMatcher
+{
+    string prefix;                   // what has been typed since the last clear / enter
+    vector<unsigned int> candidates; // indexes into the wordStore of words starting with prefix, kept in order
+    array<vector<unsigned int>, 256> byFirstByte; // indexes of every live word by its first byte, in order too
+};
 
 struct termios initialTerm;
 //generates random seed so words don't come out in the same "random" order each time
@@ -139,383 +331,6134 @@ auto SetNonblockingReadState(bool desiredState = true) -> void
     cerr << "SetNonblockingReadState [" << desiredState << "]" << endl;
 }
 
+// reads a whole argument as a number, false if it isn't one or doesn't fit
+// (unlike stoul, which throws and takes the program down with it)
+template <typename numberType>
+auto ParseNumber(string_view text, numberType &number) -> bool
+{
+    auto [end, error]{from_chars(text.data(), text.data() + text.size(), number)};
+    return error == errc() and end == text.data() + text.size();
+}
+
+// Escape Sequences
+// The SGR sequence for every colour code is worked out at compile time, and the
+// numbers in cursor moves are formatted with to_chars straight into the caller's
+// buffer, so drawing doesn't build any temporary strings or go through an ostream.
+
+const unsigned int COLOUR_CODES{48}; // every foreground (30-37) and background (40-47) code is below this
+const size_t MAX_CURSOR_MOVE{24};    // ESC [ row ; col H with two 32 bit numbers
+
+struct escapeCode
+{
+    array<char, 8> text{};
+    unsigned int length{0};
+};
+
+// "\033[0m" for COLOUR_IGNORE, "\033[1;3Xm" for a foreground colour and "\033[4Xm" for
+// a background one (a background is its foreground code + 10), nothing for anything else
+constexpr auto MakeColourTable() -> array<escapeCode, COLOUR_CODES>
+{
+    array<escapeCode, COLOUR_CODES> table{};
+    for (unsigned int colour = 0; colour < COLOUR_CODES; colour++)
+    {
+        escapeCode &code{table[colour]};
+        auto put{[&code](char letter)
+                 { code.text[code.length++] = letter; }};
+        bool foreground{colour >= COLOUR_BLACK and colour <= COLOUR_WHITE};
+        bool background{colour >= COLOUR_BLACK + 10 and colour <= COLOUR_WHITE + 10};
+        if (colour != COLOUR_IGNORE and not foreground and not background)
+        {
+            continue;
+        }
+        put('\033');
+        put('[');
+        if (colour == COLOUR_IGNORE)
+        {
+            put('0');
+        }
+        else
+        {
+            if (foreground)
+            {
+                put('1');
+                put(';');
+            }
+            put(static_cast<char>('0' + colour / 10));
+            put(static_cast<char>('0' + colour % 10));
+        }
+        put('m');
+    }
+    return table;
+}
+
+constexpr array<escapeCode, COLOUR_CODES> COLOUR_SEQUENCES{MakeColourTable()};
+static_assert(string_view(COLOUR_SEQUENCES[COLOUR_RED].text.data(), COLOUR_SEQUENCES[COLOUR_RED].length) == "\033[1;31m");
+static_assert(string_view(COLOUR_SEQUENCES[COLOUR_IGNORE].text.data(), COLOUR_SEQUENCES[COLOUR_IGNORE].length) == "\033[0m");
+
+// writes ESC [ row ; col H at out, returns the end (out needs MAX_CURSOR_MOVE chars)
+auto WriteCursorMove(char *out, unsigned int row, unsigned int col) -> char *
+{
+    char *end{out + MAX_CURSOR_MOVE};
+    *out++ = '\033';
+    *out++ = '[';
+    out = to_chars(out, end, row).ptr;
+    *out++ = ';';
+    out = to_chars(out, end, col).ptr;
+    *out++ = 'H';
+    return out;
+}
+
+// writes ESC [ count C (cursor right) at out, returns the end
+auto WriteCursorRight(char *out, unsigned int count) -> char *
+{
+    char *end{out + MAX_CURSOR_MOVE};
+    *out++ = '\033';
+    *out++ = '[';
+    out = to_chars(out, end, count).ptr;
+    *out++ = 'C';
+    return out;
+}
+
+auto AppendCursorMove(string &output, unsigned int row, unsigned int col) -> void
+{
+    char sequence[MAX_CURSOR_MOVE];
+    output.append(sequence, WriteCursorMove(sequence, row, col));
+}
+
+auto AppendCursorRight(string &output, unsigned int count) -> void
+{
+    char sequence[MAX_CURSOR_MOVE];
+    output.append(sequence, WriteCursorRight(sequence, count));
+}
+
+// appends the SGR sequence that switches the terminal to this colour
+auto AppendColour(string &output, const unsigned int colour) -> void
+{
+    const escapeCode &code{COLOUR_SEQUENCES[colour < COLOUR_CODES ? colour : COLOUR_IGNORE]};
+    output.append(code.text.data(), code.length);
+}
+
+// appends text in the given colours, then switches back to the default
+auto AppendColoured(string &output, string_view text, const unsigned int foregroundColour = COLOUR_WHITE, const unsigned int backgroundColour = COLOUR_IGNORE) -> void
+{
+    AppendColour(output, foregroundColour);
+    if (backgroundColour) // evaluates if background colour isn't IGNORE values
+    {
+        AppendColour(output, backgroundColour + 10);
+    }
+    output += text;
+    output += STOP_COLOUR;
+}
+
 // Everything from here on is based on ANSI codes
 // Note the use of "flush" after every write to ensure the screen updates
 auto ClearScreen() -> void { cout << ANSI_START << "2J" << flush; }
-auto MoveTo(unsigned int x, unsigned int y) -> void { cout << ANSI_START << x << ";" << y << "H" << flush; }
+auto MoveTo(unsigned int x, unsigned int y) -> void
+{
+    char sequence[MAX_CURSOR_MOVE];
+    cout.write(sequence, WriteCursorMove(sequence, x, y) - sequence) << flush;
+}
 auto HideCursor() -> void { cout << ANSI_START << "?25l" << flush; }
 auto ShowCursor() -> void { cout << ANSI_START << "?25h" << flush; }
-auto GetTerminalSize() -> positionStruct
+// asks the terminal where the cursor is after moving it as far as it goes, only used
+// when the size can't be read with ioctl; gives up (returns 0 by 0) after timeoutMs
+auto QueryTerminalSize(int timeoutMs) -> positionStruct
 {
     // This feels sketchy but is actually about the only way to make this work
     MoveTo(999, 999);
     cout << ANSI_START << "6n" << flush;
+    // reply format is ESC[nnn;mmmR
     string responseString;
-    char currentChar{static_cast<char>(getchar())};
-    cout << currentChar;
-    while (currentChar != 'R')
+    auto deadline{chrono::steady_clock::now() + chrono::milliseconds(timeoutMs)};
+    while (responseString.empty() or responseString.back() != 'R')
     {
+        int remainingMs{static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count())};
+        struct pollfd watched{0, POLLIN, 0};
+        char currentChar;
+        if (remainingMs <= 0 or poll(&watched, 1, remainingMs) <= 0 or read(0, &currentChar, 1) != 1)
+        {
+            cerr << "terminal didn't answer the size query" << endl;
+            return {0, 0};
+        }
         responseString += currentChar;
-        currentChar = getchar();
     }
-    // format is ESC[nnn;mmm ... so remove the first 2 characters + split on ; + convert to unsigned int
-    responseString.erase(0, 2);
-    auto semicolonLocation = responseString.find(";");
-    auto rowsString{responseString.substr(0, semicolonLocation)};
-    auto colsString{responseString.substr((semicolonLocation + 1), responseString.size())};
-    auto rows = stoul(rowsString);
-    auto cols = stoul(colsString);
-    positionStruct returnSize{static_cast<int>(rows), static_cast<int>(cols)};
-    return returnSize;
+    unsigned int rows{0};
+    unsigned int cols{0};
+    auto semicolonLocation{responseString.find(";")};
+    if (responseString.length() < 4 or semicolonLocation == string::npos)
+    {
+        return {0, 0};
+    }
+    from_chars(responseString.data() + 2, responseString.data() + semicolonLocation, rows);
+    from_chars(responseString.data() + semicolonLocation + 1, responseString.data() + responseString.size() - 1, cols);
+    return {static_cast<int>(rows), static_cast<int>(cols)};
 }
 
-// defaults: foreground white, no background
-auto MakeColour(string inputString, const unsigned int foregroundColour = COLOUR_WHITE, const unsigned int backgroundColour = COLOUR_IGNORE) -> string
+// the window size as the kernel knows it, 0 by 0 if it doesn't (never touches stdin)
+auto ReadWindowSize() -> positionStruct
 {
-    string outputString;
-    outputString += ANSI_START;
-    outputString += START_COLOUR_PREFIX;
-    outputString += to_string(foregroundColour);
-    if (backgroundColour) // evaluates if background colour isn't IGNORE values
+    struct winsize windowSize{};
+    for (int fileDescriptor : {1, 0})
     {
-        outputString += ";";
-        outputString += to_string((backgroundColour + 10)); // Tacky but works
+        if (ioctl(fileDescriptor, TIOCGWINSZ, &windowSize) == 0 and windowSize.ws_row > 0 and windowSize.ws_col > 0)
+        {
+            return {windowSize.ws_row, windowSize.ws_col};
+        }
     }
-    outputString += START_COLOUR_SUFFIX;
-    outputString += inputString;
-    outputString += STOP_COLOUR;
-    return outputString;
+    return {0, 0};
 }
 
-
-auto UpdateWordColumnPositions(wordvector & activeWords) -> void
+// the kernel knows the window size, so this normally doesn't have to wait on the terminal at all
+// (only for before the game starts, the fallback query reads stdin and would eat keypresses)
+auto GetTerminalSize() -> positionStruct
 {
-    // Deal with movement commands
-    // Update the position of each word
-    // Use a reference so that the actual position updates
-    for (auto &currentWord : activeWords)
+    positionStruct size{ReadWindowSize()};
+    if (size.row > 0 and size.col > 0)
     {
-        // temporarily store the column (so we can ensure it's within the boundary)
-        int proposedCol{currentWord.position.col};
-        int wordLength{static_cast<int>(currentWord.content.length())};
-        // just move right, by the same amount each time
-        // possibly add speed so it increments by different amount depending on score
-        proposedCol += 1;
+        return size;
+    }
+    return QueryTerminalSize(500);
+}
 
-        //check if word at certain location, if it is change word colour
-        if (proposedCol < RED_STAGE_START and proposedCol >= YELLOW_STAGE_START)
-        {
-            currentWord.colour = COLOUR_YELLOW;
-        }
-        else if (proposedCol >= RED_STAGE_START)
-        {
-            currentWord.colour = COLOUR_RED;
-        }
+// set from the SIGWINCH handler, the game loop picks up the new size on its next pass
+atomic<bool> terminalResized{false};
 
-        // moves right -- boundary of 70 - wordLength so the ends of the words hit a boundary instead of a beginning
-        currentWord.position.col = min((70 - wordLength), proposedCol);
-    }
+auto NoteTerminalResized(int) -> void
+{
+    terminalResized = true;
 }
 
-// creates word in vector
-auto CreateWord(wordvector &activeWords, vector<string> wordList) -> void
+// set from the SIGINT / SIGTERM handler, ctrl-c quits like typing "quit" so the terminal gets put back
+atomic<bool> gameInterrupted{false};
+
+auto NoteGameInterrupted(int) -> void
 {
-    // distribution to pick random words from list
-    uniform_int_distribution<unsigned int> wordindex(0, wordList.size() - 1);
-    // distribution to pick starting row from (limit to box dimensions)
-    uniform_int_distribution<int> startrow(2, 31);
-    //cerr << "Creating word" << endl;
-    // init new words with a random word and start position
-    word newWord{
-        .content = wordList[wordindex(generator)],
-        .position = {startrow(generator), 1},
-        .cleared = false,
-        .colour = COLOUR_GREEN,
-    };
-    activeWords.push_back(newWord);
+    gameInterrupted = true;
+}
+
+// defaults: foreground white, no background
+auto MakeColour(string_view inputString, const unsigned int foregroundColour = COLOUR_WHITE, const unsigned int backgroundColour = COLOUR_IGNORE) -> string
+{
+    string outputString;
+    AppendColoured(outputString, inputString, foregroundColour, backgroundColour);
+    return outputString;
+}
+
+// UTF-8
+// Word lists (and anything typed) can be in any language, so text is UTF-8 and a
+// word's length in bytes isn't how much room it takes on screen: accented letters
+// are two bytes but one column, most CJK characters are three bytes but two columns,
+// and combining marks take no room at all. Dictionaries are checked and measured once
+// when they're loaded (see dictionaryEntry), so nothing here runs per tick. Nearly
+// every word list is plain ASCII, so the check skips over ASCII 16 bytes at a time
+// (8 without SSE2) and only decodes from the first byte with its top bit set.
+
+// (first, last) code point ranges, sorted, from Unicode's East Asian Width and general category tables
+const array<pair<char32_t, char32_t>, 10> ZERO_WIDTH_RANGES{{
+    {0x0300, 0x036F}, // combining diacritical marks
+    {0x0483, 0x0489},
+    {0x0591, 0x05BD},
+    {0x0610, 0x061A},
+    {0x064B, 0x065F},
+    {0x200B, 0x200F}, // zero width space, joiners and direction marks
+    {0x20D0, 0x20FF},
+    {0xFE00, 0xFE0F}, // variation selectors
+    {0xFE20, 0xFE2F},
+    {0xE0100, 0xE01EF},
+}};
+
+const array<pair<char32_t, char32_t>, 12> WIDE_RANGES{{
+    {0x1100, 0x115F},   // hangul jamo
+    {0x2E80, 0x303E},   // CJK radicals and punctuation
+    {0x3041, 0x33FF},   // kana, bopomofo, CJK compatibility
+    {0x3400, 0x4DBF},   // CJK extension A
+    {0x4E00, 0x9FFF},   // CJK unified ideographs
+    {0xA000, 0xA4CF},   // yi
+    {0xAC00, 0xD7A3},   // hangul syllables
+    {0xF900, 0xFAFF},   // CJK compatibility ideographs
+    {0xFE30, 0xFE4F},
+    {0xFF00, 0xFF60},   // fullwidth forms
+    {0x1F300, 0x1FAFF}, // emoji
+    {0x20000, 0x3FFFD}, // CJK extensions B onwards
+}};
+
+template <size_t rangeCount>
+auto InRanges(const array<pair<char32_t, char32_t>, rangeCount> &ranges, char32_t codePoint) -> bool
+{
+    auto after{upper_bound(ranges.begin(), ranges.end(), codePoint, [](char32_t value, const pair<char32_t, char32_t> &range)
+                           { return value < range.first; })};
+    return after != ranges.begin() and codePoint <= prev(after)->second;
 }
 
-// displays all active words
-auto DisplayWords(wordvector activeWords) -> void
+// columns a character takes up in a terminal
+auto CharacterWidth(char32_t codePoint) -> int
 {
-    for (auto currentWord : activeWords)
+    if (codePoint < 0x300)
+    {
+        return 1;
+    }
+    if (InRanges(ZERO_WIDTH_RANGES, codePoint))
     {
-        MoveTo(currentWord.position.row, currentWord.position.col);
-        cout << MakeColour(currentWord.content, currentWord.colour) << flush;
+        return 0;
     }
+    return InRanges(WIDE_RANGES, codePoint) ? 2 : 1;
 }
 
-// removes words from the wordvector when they reach the boundary
-auto ClearWords(wordvector &activeWords, unsigned int &score, unsigned int &lives) -> void
+// how many bytes at the start of text are plain ASCII
+auto AsciiPrefixLength(string_view text) -> size_t
 {
-    // index never negative so use unsigned
-    for (unsigned int i = 0; i < activeWords.size(); i++)
-    { // no need to pass by ref (not changing word elements)
-        word currentWord = activeWords[i];
-        int wordLength{static_cast<int>(currentWord.content.length())};
-        if (currentWord.cleared == true)
+    size_t position{0};
+#if defined(__SSE2__)
+    for (; position + 16 <= text.size(); position += 16)
+    {
+        __m128i chunk{_mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + position))};
+        unsigned int highBits{static_cast<unsigned int>(_mm_movemask_epi8(chunk))}; // one bit per byte, from the top bit of each
+        if (highBits != 0)
+        {
+            return position + countr_zero(highBits);
+        }
+    }
+#endif
+    for (; position + 8 <= text.size(); position += 8)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, text.data() + position, sizeof(chunk));
+        uint64_t highBits{chunk & 0x8080808080808080ULL};
+        if (highBits != 0)
         {
-            //cerr << "erased: " << currentWord.content << endl;
-            activeWords.erase(activeWords.begin() + i);
-            score += wordLength * 10;
+            return position + (endian::native == endian::little ? countr_zero(highBits) : countl_zero(highBits)) / 8;
         }
-        else if (currentWord.position.col == (70 - wordLength)) // 70 is column boundary, account for different length words
-        {                                               
-            activeWords.erase(activeWords.begin() + i); // begin + index bc we need to use an iterator
-            lives -= 1;
+    }
+    while (position < text.size() and static_cast<unsigned char>(text[position]) < 0x80)
+    {
+        position += 1;
+    }
+    return position;
+}
+
+// decodes the character at the start of text, returns how many bytes it took or 0 if it
+// isn't valid UTF-8 (a stray continuation byte, a sequence cut short, an overlong
+// encoding, a surrogate or anything past U+10FFFF)
+auto DecodeUtf8(string_view text, char32_t &codePoint) -> int
+{
+    if (text.empty())
+    {
+        return 0;
+    }
+    unsigned char lead{static_cast<unsigned char>(text[0])};
+    if (lead < 0x80)
+    {
+        codePoint = lead;
+        return 1;
+    }
+    int length{lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0};
+    if (length == 0 or static_cast<int>(text.size()) < length)
+    {
+        return 0;
+    }
+    codePoint = lead & (0x7F >> length);
+    for (int i = 1; i < length; i++)
+    {
+        unsigned char next{static_cast<unsigned char>(text[i])};
+        if ((next & 0xC0) != 0x80)
+        {
+            return 0;
         }
+        codePoint = (codePoint << 6) | (next & 0x3F);
+    }
+    const array<char32_t, 5> SMALLEST{0, 0, 0x80, 0x800, 0x10000};
+    if (codePoint < SMALLEST[length] or codePoint > 0x10FFFF or (codePoint >= 0xD800 and codePoint <= 0xDFFF))
+    {
+        return 0;
     }
+    return length;
 }
 
-// checks if word matches any that already exists
-auto CheckMatchedWord(wordvector &activeWords, string attempt, bool & quit) -> void
+// counts the code points in text and the columns they take up, false if it isn't valid UTF-8
+auto MeasureText(string_view text, unsigned int &codePoints, unsigned int &width) -> bool
 {
-    for (auto &currentWord : activeWords)
+    codePoints = 0;
+    width = 0;
+    size_t position{0};
+    char32_t codePoint{0};
+    while (true)
     {
-        if (attempt == currentWord.content)
+        size_t ascii{AsciiPrefixLength(text.substr(position))};
+        codePoints += ascii;
+        width += ascii;
+        position += ascii;
+        if (position == text.size())
         {
-            currentWord.cleared = true;
-            //cerr << "cleared: " << currentWord.content << endl;
+            return true;
         }
-        else if (attempt == "quit")
+        int length{DecodeUtf8(text.substr(position), codePoint)};
+        if (length == 0)
         {
-            quit = true;
+            return false;
         }
-        // check for pause here and set boolean (later)
+        codePoints += 1;
+        width += CharacterWidth(codePoint);
+        position += length;
     }
 }
 
-// shows current score 
-auto ShowStats(unsigned int score, unsigned int lives) -> void
+// Screen Buffer
+// Instead of clearing and repainting the whole terminal every tick, each frame is
+// drawn into a back buffer (one cell per character on screen). PresentFrame then
+// compares it against the front buffer (what the terminal is already showing) and
+// only sends the cells that changed, all in a single write().
+
+struct screenCell
+{
+    uint32_t glyph;      // the character's UTF-8 bytes, first byte lowest (0 for the right half of a wide character)
+    unsigned int colour; // COLOUR_IGNORE means the terminal's default colour
+};
+
+auto operator==(const screenCell &left, const screenCell &right) -> bool
 {
-    cout << "score: " << score << "\tlives: " << lives << flush;
+    return (left.glyph == right.glyph) and (left.colour == right.colour);
 }
 
-// function to load file
-// pass by reference to directly manipulate wordlist vector
-auto LoadWordList(string fileName, vector<string> &wordList) -> void
+const screenCell BLANK_CELL{' ', COLOUR_IGNORE};
+
+struct screenBuffer
 {
-    ifstream input(fileName);
-    string wordInList;
+    int rows{0};
+    int cols{0};
+    vector<screenCell> front; // what the terminal is currently showing
+    vector<screenCell> back;  // what the next frame should look like
+    bool repaintAll{true};    // front buffer can't be trusted (first frame, resize)
+    string output;            // kept between frames so it only allocates once
+    size_t bytesLastFrame{0};
+    unsigned long long bytesTotal{0};
+    unsigned long long framesPresented{0};
+    int cursorRow{1}; // where the last frame left the cursor
+    int cursorCol{1};
+    unsigned int terminalColour{COLOUR_IGNORE + 1}; // the colour the last frame left set, COLOUR_IGNORE + 1 if we don't know
+};
 
-    while (getline(input, wordInList))
-    {
-        wordList.push_back(wordInList);
-    }
+auto ResizeScreen(screenBuffer &screen, int rows, int cols) -> void
+{
+    screen.rows = rows;
+    screen.cols = cols;
+    screen.front.assign(rows * cols, BLANK_CELL);
+    screen.back.assign(rows * cols, BLANK_CELL);
+    screen.repaintAll = true;
+}
 
-    input.close();
+auto ClearBackBuffer(screenBuffer &screen) -> void
+{
+    fill(screen.back.begin(), screen.back.end(), BLANK_CELL);
 }
 
-// load high score file into map
-// pass map by ref to store values in it directly
-auto LoadHighScores(string fileName, map<string, unsigned int> &highScores) -> void
+// rows and columns start at 1 like the ANSI codes, anything off screen is clipped
+// returns the column just after the text
+auto DrawText(screenBuffer &screen, int row, int col, string_view text, const unsigned int colour = COLOUR_IGNORE) -> int
 {
-    // init input stream to read from external file
-    ifstream scoreFile(fileName);
-    string currentLine;
-    string userName;
-    int totalLines{0};
-    int totalLines = 0;
-    while (getline(scoreFile, currentLine))
-    { // loop through file
-        totalLines += 1;
-        if (totalLines % 2 == 1)
-        { // odd lines have name
-            userName = currentLine;
+    bool visible{row >= 1 and row <= screen.rows};
+    screenCell *cells{visible ? &screen.back[(row - 1) * screen.cols] : nullptr};
+    auto onScreen{[&screen, visible](int currentCol)
+                  { return visible and currentCol >= 1 and currentCol <= screen.cols; }};
+    int currentCol{col};
+    size_t position{0};
+    while (position < text.size())
+    {
+        unsigned char lead{static_cast<unsigned char>(text[position])};
+        if (lead < 0x80)
+        {
+            if (onScreen(currentCol))
+            {
+                cells[currentCol - 1] = {lead, colour};
+            }
+            currentCol += 1;
+            position += 1;
+            continue;
         }
-        else
+        char32_t codePoint{0};
+        int length{DecodeUtf8(text.substr(position), codePoint)};
+        if (length == 0)
+        { // not UTF-8 (or cut off part way through a character)
+            if (onScreen(currentCol))
+            {
+                cells[currentCol - 1] = {'?', colour};
+            }
+            currentCol += 1;
+            position += 1;
+            continue;
+        }
+        uint32_t glyph{0};
+        for (int i = 0; i < length; i++)
         {
-            unsigned int score = stoul(currentLine); // even lines have score
-            highScores[userName] = score;            // add to map
-            //cerr << userName << ", " << score;
+            glyph |= static_cast<uint32_t>(static_cast<unsigned char>(text[position + i])) << (8 * i);
+        }
+        position += length;
+        int width{CharacterWidth(codePoint)};
+        if (width == 0)
+        { // a combining mark goes in with the character before it, if there's room
+            int previousCol{currentCol - 1};
+            if (onScreen(previousCol) and cells[previousCol - 1].glyph == 0)
+            {
+                previousCol -= 1;
+            }
+            if (onScreen(previousCol) and bit_width(cells[previousCol - 1].glyph) + 8 * length <= 32)
+            {
+                cells[previousCol - 1].glyph |= glyph << ((bit_width(cells[previousCol - 1].glyph) + 7) / 8 * 8);
+            }
+            continue;
+        }
+        if (onScreen(currentCol))
+        { // a wide character with no room for its right half isn't drawn
+            cells[currentCol - 1] = width == 1 or onScreen(currentCol + 1) ? screenCell{glyph, colour} : screenCell{' ', colour};
         }
+        if (width == 2 and onScreen(currentCol + 1))
+        { // and one cut off at the left just shows its right half as a space
+            cells[currentCol] = onScreen(currentCol) ? screenCell{0, colour} : screenCell{' ', colour};
+        }
+        currentCol += width;
     }
-    // close input stream
-    scoreFile.close();
+    return currentCol;
 }
 
-// display start menu, allow for user interaction to start/quit game or view rules
-auto StartMenu(string &name) -> bool
+// write() can accept less than we asked for, so keep going until it's all out
+auto WriteAll(int fileDescriptor, const char *data, size_t length) -> void
 {
-    cout << "*********************" << endl;
-    cout << "WELCOME TO TYPESPEED!" << endl;
-    cout << "*********************" << endl;
-    cout << MakeColour("\ntype \"start\" to start playing, \"rules\" to see rules, or \"quit\" to exit:", COLOUR_CYAN) << endl;
-
-    string command;
-    // get command from user input
-    cin >> command;
-    // loop until user chooses to leave menu or proceed to game
-    while (command.compare("start") != 0 and command.compare("quit") != 0)
+    while (length > 0)
     {
-        if (command.compare("rules") == 0)
+        auto written{write(fileDescriptor, data, length)};
+        if (written < 0)
         {
-            cout << "\nHOW IT WORKS:\n* when you start playing, you'll see words moving across the screen: it's your job to type them in!" << endl;
-            cout << "* when you type the word in correctly, you get to clear the word." << endl;
-            cout << "* points will be calculated based on the length of the words you clear." << endl;
-            cout << "* if you don't clear words before they hit the boundary, you'll lose a life. if you lose 5 lives, the game will end." << endl;
-            cout << "\n* once you've typed a character, you can't delete it, so accuracy matters just as much as speed." << endl;
-            cout << "\n* if you want to quit at any point, type \"quit\" in. we won't judge you for it." << endl;
-
-            cout << "\nwe hope you enjoy our game! - anna, jessica and tiffany <3" << endl;
-        }
-        else
-        { // input does not match any valid command
-            cout << MakeColour("invalid command, try again ;)", COLOUR_RED) << endl;
+            if (errno == EINTR or errno == EAGAIN)
+            {
+                continue;
+            }
+            cerr << "WriteAll failed [" << errno << "]" << endl;
+            return;
         }
-        cout << MakeColour("\ntype \"start\" to start playing, \"rules\" to see rules, or \"quit\" to exit:", COLOUR_CYAN) << endl;
-        cin >> command;
+        data += written;
+        length -= written;
     }
-    // user wants to proceed to game
-    if (command.compare("start") == 0)
+}
+
+// puts the difference between the back and front buffers into screen.output, followed
+// by a move to (cursorRow, cursorCol) so the user can see where they're typing
+auto EncodeFrame(screenBuffer &screen, int cursorRow, int cursorCol) -> void
+{
+    string &output{screen.output};
+    output.clear();
+
+    if (screen.repaintAll)
     {
-        // get their name to be used in high score list
-        cout << MakeColour("\nbefore we begin, what's your name? it'll be saved for high scores :)", COLOUR_MAGENTA) << endl;
-        cin >> name;
-        return true;
+        output += STOP_COLOUR;
+        output += ANSI_START;
+        output += "2J";
+        fill(screen.front.begin(), screen.front.end(), BLANK_CELL);
+        screen.repaintAll = false;
+        screen.terminalColour = COLOUR_IGNORE;
     }
-    return false;
-}
 
-// displays game over, user score and specific tailored message depending on score
-auto ShowEndScreen(unsigned int score, unsigned int scorelevel = 500) -> void
-{
-    cout << " _____ ____  _      _____   ____  _     _____ ____\n"
-         << flush;
-    cout << "/  __//  _ \\/ \\__/|/  __/  /  _ \\/ \\ |\\/  __//  __\\\n"
-         << flush;
-    cout << "| |  _| / \\|| |\\/|||  \\    | / \\|| | //|  \\  |  \\/|\n"
-         << flush;
-    cout << "| |_//| |-||| |  |||  /_   | \\_/|| \\// |  /_ |    /\n"
-         << flush;
-    cout << "\\____\\\\_/ \\|\\_/  \\|\\____\\  \\____/\\__/  \\____\\\\_/\\_\\\n\n"
-         << flush;
-    /* scorelevel is default value because if implemented different levels of play (chosen by player at beginning), 
-       scorelevel for a positive message can be adjusted */
+    // -1 means we don't know where the terminal's cursor is, the colour carries on from the last
+    // frame (which always ends back on the default, so a viewer can start from any keyframe)
+    int terminalRow{-1};
+    int terminalCol{-1};
+    unsigned int terminalColour{screen.terminalColour};
+    bool cursorHidden{false};
 
-    // only display compliment if score over threshold
-    if (score > scorelevel)
+    for (int row = 1; row <= screen.rows; row++)
     {
-        cout << "you're a pro 😤\n\n"
-             << "score: " << score << "\n"
-             << flush;
+        for (int col = 1; col <= screen.cols; col++)
+        {
+            unsigned int index{static_cast<unsigned int>((row - 1) * screen.cols + (col - 1))};
+            const screenCell &wanted{screen.back[index]};
+            if (wanted == screen.front[index])
+            {
+                continue;
+            }
+            if (wanted.glyph == 0)
+            { // the right half of a wide character, which went out with its left half
+                screen.front[index] = wanted;
+                continue;
+            }
+            if (not cursorHidden)
+            {
+                // hide the cursor while drawing so it doesn't jump around the screen
+                output += ANSI_START;
+                output += "?25l";
+                cursorHidden = true;
+            }
+            if (row != terminalRow or col != terminalCol)
+            {
+                if (row == terminalRow and col > terminalCol)
+                {
+                    // moving right along the same row is shorter than a full move
+                    AppendCursorRight(output, col - terminalCol);
+                }
+                else
+                {
+                    AppendCursorMove(output, row, col);
+                }
+            }
+            if (wanted.colour != terminalColour)
+            {
+                AppendColour(output, wanted.colour);
+                terminalColour = wanted.colour;
+            }
+            // a wide character moves the cursor on two columns
+            int width{col < screen.cols and screen.back[index + 1].glyph == 0 ? 2 : 1};
+            for (uint32_t glyph = wanted.glyph; glyph != 0; glyph >>= 8)
+            {
+                output += static_cast<char>(glyph & 0xFF);
+            }
+            screen.front[index] = wanted;
+            terminalRow = row;
+            // the last column leaves the cursor in a "pending wrap" state, so don't guess
+            terminalCol = (col + width <= screen.cols) ? (col + width) : -1;
+        }
     }
-    else
+
+    if (cursorHidden or cursorRow != terminalRow or cursorCol != terminalCol)
     {
-        cout << "you tried? 😕\n\n"
-             << "score: " << score << "\n"
-             << flush;
-    }
-}
-
-// determines whether user achieved a score in the top 3 all time
-// then, displays high scores and saves them for future plays
-auto ProcessHighScores(string fileName, map<string, unsigned int> &highScores, string userName, unsigned int score) -> void
-{
-    cout << "\nCURRENT HIGH SCORES" << endl;
-    string lowestUser;
-    unsigned int lowestScore;
-    bool firstScore{true};
-    // stream to write to external file
-    ofstream output(fileName);
-
-    // loop through key value pairs in high score map
-    for (auto const &[key, val] : highScores)
-    {
-        if (firstScore)
-        { // set the first pair in the map to lowest for comparison
-            lowestScore = val;
-            lowestUser = key;
-            firstScore = false;
-        }
-        else if (val < lowestScore)
-        { // then check if the other pairs are lower
-            lowestScore = val;
-            lowestUser = key;
-            //cerr << lowestScore << endl;
-        }
-    }
-
-    // check if the user's score qualifies to replace the top 3 scores
-    if (score > lowestScore)
-    {
-        // remove the lowest score in the map
-        // NOTE: if user name same as lowest user's name, will remove 3rd top score
-        highScores.erase(lowestUser);
-        // add the user score to the map
-        highScores[userName] = score;
-    }
-
-    // loop through the new list of high scores (including user's, if they qualified)
-    // sort later
-    for (auto const &[key, val] : highScores)
-    {
-        // display AND write to file
-        output << key << "\n" << val << endl;
-        cout << key << "\t" << val << endl;
-    }
-    // close output stream
-    output.close();
-}
-
-auto border() -> void
-{
-    //hard code instead of for loop because for loop makes it buggy/choppy output screen
-    cout << "_____________________________________________________________________ \n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "|                                                                    |\n" << flush;
-    cout << "--------------------------------------------------------------------- " << flush;
-}
-
-auto main() -> int
+        if (terminalColour != COLOUR_IGNORE)
+        {
+            output += STOP_COLOUR;
+            terminalColour = COLOUR_IGNORE;
+        }
+        AppendCursorMove(output, cursorRow, cursorCol);
+        output += ANSI_START;
+        output += "?25h";
+    }
+
+    screen.cursorRow = cursorRow;
+    screen.cursorCol = cursorCol;
+    screen.terminalColour = terminalColour;
+    screen.bytesLastFrame = output.size();
+    screen.bytesTotal += output.size();
+    screen.framesPresented += 1;
+}
+
+// encodes the changes and sends them to the terminal in a single write()
+auto PresentFrame(screenBuffer &screen, int cursorRow, int cursorCol) -> void
 {
+    EncodeFrame(screen, cursorRow, cursorCol);
+    WriteAll(1, screen.output.data(), screen.output.size());
+}
 
-    // Set Up the system to receive input
-    SetupScreenAndInput();
-    // Check that the terminal size is large enough for the game to be played
-    const positionStruct TERMINAL_SIZE{GetTerminalSize()};
+// Tick Scheduler
+// The game loop sleeps in poll() on stdin plus a timerfd that fires every simulation
+// step, so an idle game uses (almost) no CPU and keystrokes wake it up straight away.
+// The kernel keeps the timer on a fixed schedule, so late ticks don't pile up drift,
+// and says how many steps are due, so a late wake up runs the steps it missed.
+// We still record how late / uneven each tick was so it can be checked.
 
-    //cerr << TERMINAL_SIZE.row << endl;
-    // check if terminal size too small; if so initiate exit
-    if ((TERMINAL_SIZE.row < 35) or (TERMINAL_SIZE.col < 70))
-    {
-        ShowCursor();
-        TeardownScreenAndInput();
-        cout << endl
-             << "Terminal window must be at least 35 by 70 to run this game" << endl;
-        return EXIT_FAILURE;
-    }
+struct tickScheduler
+{
+    int timerFd{-1};
+    chrono::nanoseconds period{0};
+    chrono::steady_clock::time_point startTime;
+    chrono::steady_clock::time_point lastTickTime;
+    unsigned long long expirations{0}; // how many periods have passed since start
+    unsigned long long ticksHandled{0};
+    unsigned long long ticksMissed{0}; // expirations that arrived together with another one
+    unsigned long long wakeups{0};
+    // drift: how long after its scheduled time each tick was actually handled
+    long long driftTotalNs{0};
+    long long driftMaxNs{0};
+    // jitter: how far the gap between two ticks was from the tick period
+    long long jitterTotalNs{0};
+    long long jitterMaxNs{0};
+};
 
-    // need to reset input to allow cin to process correctly (default input mode)
-    TeardownScreenAndInput();
+struct schedulerEvents
+{
+    bool inputReady;
+    bool tickDue;
+    unsigned long long stepsDue; // timer periods since the last wake up
+};
+
+auto StartTickScheduler(tickScheduler &scheduler, int periodMs) -> bool
+{
+    scheduler.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (scheduler.timerFd < 0)
+    {
+        cerr << "timerfd_create failed [" << errno << "]" << endl;
+        return false;
+    }
+    scheduler.period = chrono::milliseconds(periodMs);
+    struct itimerspec timerSpec{};
+    timerSpec.it_interval.tv_sec = periodMs / 1000;
+    timerSpec.it_interval.tv_nsec = (periodMs % 1000) * 1000000L;
+    timerSpec.it_value = timerSpec.it_interval;
+    scheduler.startTime = chrono::steady_clock::now();
+    scheduler.lastTickTime = scheduler.startTime;
+    if (timerfd_settime(scheduler.timerFd, 0, &timerSpec, nullptr) < 0)
+    {
+        cerr << "timerfd_settime failed [" << errno << "]" << endl;
+        close(scheduler.timerFd);
+        scheduler.timerFd = -1;
+        return false;
+    }
+    return true;
+}
+
+auto StopTickScheduler(tickScheduler &scheduler) -> void
+{
+    if (scheduler.timerFd >= 0)
+    {
+        close(scheduler.timerFd);
+        scheduler.timerFd = -1;
+    }
+}
+
+// blocks until stdin has something to read and/or the next tick is due,
+// or timeoutMs has passed (-1 waits as long as it takes)
+auto WaitForEvents(tickScheduler &scheduler, int inputFd, int timeoutMs = -1) -> schedulerEvents
+{
+    schedulerEvents events{false, false, 0};
+    struct pollfd watched[2]{
+        {inputFd, POLLIN, 0},
+        {scheduler.timerFd, POLLIN, 0},
+    };
+    if (poll(watched, 2, timeoutMs) < 0)
+    {
+        if (errno != EINTR)
+        {
+            cerr << "poll failed [" << errno << "]" << endl;
+        }
+        return events;
+    }
+    scheduler.wakeups += 1;
+    // a hang up or error on stdin also counts as "input" so the read sees it
+    events.inputReady = (watched[0].revents != 0);
+
+    uint64_t timerCount{0};
+    if ((watched[1].revents & POLLIN) and read(scheduler.timerFd, &timerCount, sizeof(timerCount)) == sizeof(timerCount))
+    {
+        auto now{chrono::steady_clock::now()};
+        scheduler.expirations += timerCount;
+        scheduler.ticksHandled += 1;
+        scheduler.ticksMissed += timerCount - 1;
+
+        auto scheduledTime{scheduler.startTime + scheduler.period * scheduler.expirations};
+        long long drift{chrono::duration_cast<chrono::nanoseconds>(now - scheduledTime).count()};
+        scheduler.driftTotalNs += drift;
+        scheduler.driftMaxNs = max(scheduler.driftMaxNs, drift);
+
+        long long interval{chrono::duration_cast<chrono::nanoseconds>(now - scheduler.lastTickTime).count()};
+        long long jitter{llabs(interval - static_cast<long long>(scheduler.period.count() * timerCount))};
+        scheduler.jitterTotalNs += jitter;
+        scheduler.jitterMaxNs = max(scheduler.jitterMaxNs, jitter);
+        scheduler.lastTickTime = now;
+
+        events.tickDue = true;
+        events.stepsDue = timerCount;
+    }
+    return events;
+}
+
+auto PrintTickStats(ostream &output, const tickScheduler &scheduler) -> void
+{
+    unsigned long long ticks{max(scheduler.ticksHandled, 1ULL)};
+    output << "ticks: " << scheduler.ticksHandled << " missed: " << scheduler.ticksMissed
+           << " wakeups: " << scheduler.wakeups
+           << " drift avg/max (us): " << scheduler.driftTotalNs / 1000 / static_cast<long long>(ticks)
+           << "/" << scheduler.driftMaxNs / 1000
+           << " jitter avg/max (us): " << scheduler.jitterTotalNs / 1000 / static_cast<long long>(ticks)
+           << "/" << scheduler.jitterMaxNs / 1000 << endl;
+}
+
+// Tracing
+// TRACE_SCOPE("name") times the rest of the block it's in. Every thread records into
+// its own fixed size ring (newest events overwrite the oldest), so recording takes no
+// locks and never allocates. Set TYPESPEED_TRACE=trace.json to turn it on; the rings
+// are written out as a Chrome / Perfetto trace when the program exits, or straight
+// away on SIGUSR1. Compile with -DTYPESPEED_NO_TRACE to take it all out.
+// Other threads keep recording while the rings are dumped, so each slot carries a
+// sequence number (odd while it's being written, even once it's done) that the dump
+// checks before and after copying the slot, and skips it unless both say it was done.
+
+const size_t TRACE_RING_CAPACITY{65536}; // events kept per thread, power of two
+
+// everything is atomic so a dump reading a slot mid write isn't a data race, it just fails
+// the sequence check (the fields are written with release and read with acquire, so a dump
+// that saw any new field also sees the odd number in front of it)
+struct traceSlot
+{
+    atomic<uint64_t> sequence{0}; // 2 * event number + 1 while writing, + 2 once written
+    atomic<const char *> name{nullptr};
+    atomic<int64_t> startNs{0};
+    atomic<int64_t> durationNs{0};
+};
+
+struct traceEvent
+{
+    const char *name;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+struct traceRing
+{
+    unsigned int threadNumber{0};
+    array<traceSlot, TRACE_RING_CAPACITY> events;
+    atomic<uint64_t> head{0}; // total events recorded, only written by the owning thread
+};
+
+struct traceRegistry
+{
+    mutex lock; // only taken when a thread records for the first time, and when dumping
+    vector<unique_ptr<traceRing>> rings; // owned here so they outlive their threads
+    string fileName;
+    chrono::steady_clock::time_point startTime{chrono::steady_clock::now()};
+};
+
+traceRegistry tracer;
+bool tracingEnabled{false}; // only ever set once, before any other thread starts
+atomic<bool> traceDumpRequested{false};
+
+auto TraceNow() -> int64_t
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - tracer.startTime).count();
+}
+
+auto ThisThreadTraceRing() -> traceRing &
+{
+    thread_local traceRing *ring{nullptr};
+    if (ring == nullptr)
+    {
+        lock_guard<mutex> guard(tracer.lock);
+        tracer.rings.push_back(make_unique<traceRing>());
+        ring = tracer.rings.back().get();
+        ring->threadNumber = tracer.rings.size();
+    }
+    return *ring;
+}
+
+auto RecordTrace(const char *name, int64_t startNs, int64_t endNs) -> void
+{
+    traceRing &ring{ThisThreadTraceRing()};
+    uint64_t head{ring.head.load(memory_order_relaxed)};
+    traceSlot &slot{ring.events[head & (TRACE_RING_CAPACITY - 1)]};
+    slot.sequence.store(2 * head + 1, memory_order_relaxed);
+    slot.name.store(name, memory_order_release);
+    slot.startNs.store(startNs, memory_order_release);
+    slot.durationNs.store(endNs - startNs, memory_order_release);
+    slot.sequence.store(2 * head + 2, memory_order_release);
+    ring.head.store(head + 1, memory_order_release);
+}
+
+struct scopedTrace
+{
+    const char *name;
+    int64_t startNs;
+    explicit scopedTrace(const char *phaseName) : name(phaseName), startNs(tracingEnabled ? TraceNow() : 0) {}
+    ~scopedTrace()
+    {
+        if (tracingEnabled)
+        {
+            RecordTrace(name, startNs, TraceNow());
+        }
+    }
+};
+
+#ifdef TYPESPEED_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_JOIN(left, right) left##right
+#define TRACE_NAME(line) TRACE_JOIN(traceScope, line)
+#define TRACE_SCOPE(name) scopedTrace TRACE_NAME(__LINE__)(name)
+#endif
+
+// writes every ring out in the Chrome trace event format (times are in microseconds)
+auto DumpTrace() -> void
+{
+    lock_guard<mutex> guard(tracer.lock);
+    ofstream output(tracer.fileName);
+    output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first{true};
+    char line[256];
+    for (const auto &ring : tracer.rings)
+    {
+        uint64_t head{ring->head.load(memory_order_acquire)};
+        uint64_t oldest{head > TRACE_RING_CAPACITY ? head - TRACE_RING_CAPACITY : 0};
+        vector<traceEvent> copied;
+        copied.reserve(head - oldest);
+        for (uint64_t number = oldest; number < head; number++)
+        {
+            // the owning thread may be overwriting this slot with a newer event right now
+            const traceSlot &slot{ring->events[number & (TRACE_RING_CAPACITY - 1)]};
+            if (slot.sequence.load(memory_order_acquire) != 2 * number + 2)
+            {
+                continue;
+            }
+            traceEvent event{slot.name.load(memory_order_acquire), slot.startNs.load(memory_order_acquire), slot.durationNs.load(memory_order_acquire)};
+            if (slot.sequence.load(memory_order_relaxed) == 2 * number + 2)
+            {
+                copied.push_back(event);
+            }
+        }
+        for (const traceEvent &event : copied)
+        {
+            snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     first ? "" : ",", event.name, ring->threadNumber, event.startNs / 1000.0, event.durationNs / 1000.0);
+            output << line;
+            first = false;
+        }
+    }
+    output << "\n]}\n";
+    cerr << "trace written to " << tracer.fileName << endl;
+}
+
+auto RequestTraceDump(int) -> void
+{
+    traceDumpRequested = true;
+}
+
+// called from the main loops, since a signal handler can't safely write the file itself
+auto CheckTraceDumpRequest() -> void
+{
+    if (traceDumpRequested.exchange(false) and tracingEnabled)
+    {
+        DumpTrace();
+    }
+}
+
+// turns tracing on if TYPESPEED_TRACE names a file to write it to
+auto SetupTracing() -> void
+{
+#ifndef TYPESPEED_NO_TRACE
+    const char *fileName{getenv("TYPESPEED_TRACE")};
+    if (fileName == nullptr or fileName[0] == '\0')
+    {
+        return;
+    }
+    tracer.fileName = fileName;
+    tracingEnabled = true;
+    signal(SIGUSR1, RequestTraceDump);
+    atexit(DumpTrace);
+#endif
+}
+
+// Typing Analytics
+// Each session counts how the player is typing as the keys come in, and finished
+// sessions are added into one set of totals for the whole process, which is printed
+// when it exits. Distributions go into log bucketed histograms: a fixed array of
+// counters, four to each power of two, so a value is never more than 25% off and a
+// million keystrokes take up no more room than ten.
+
+const unsigned int HISTOGRAM_SUB_BUCKETS{4};
+const unsigned int HISTOGRAM_BUCKETS{32 * HISTOGRAM_SUB_BUCKETS}; // room for any 32 bit value
+const unsigned int TRACKED_WORD_LENGTHS{16};                      // longer words share the last histogram
+const unsigned int COLOUR_STAGES{3};                              // green, yellow, red
+const int LETTERS_PER_WORD{5};                                    // the usual definition for words per minute
+
+struct logHistogram
+{
+    array<uint32_t, HISTOGRAM_BUCKETS> counts{};
+    uint64_t total{0};
+    uint64_t sum{0};
+};
+
+struct typingStats
+{
+    uint64_t keystrokes{0};
+    uint64_t accurateKeys{0}; // keys that still matched the start of a word on screen
+    uint64_t wordsCleared{0};
+    uint64_t wordsMissed{0};
+    uint64_t lettersCleared{0};
+    uint64_t ticksPlayed{0}; // only filled in when a session is added to the totals
+    uint64_t sessions{0};
+    int64_t lastKeyUs{-1};
+    logHistogram keyIntervalUs;
+    array<logHistogram, TRACKED_WORD_LENGTHS> clearMsByLength; // index is length - 1
+    array<logHistogram, COLOUR_STAGES> clearMsByStage;
+    logHistogram sessionWpm; // one sample per finished session
+};
+
+// whole process totals, sessions are added under the lock when they finish
+typingStats processTypingStats;
+mutex processTypingLock;
+
+auto HistogramBucket(uint32_t value) -> unsigned int
+{
+    if (value < HISTOGRAM_SUB_BUCKETS)
+    {
+        return value;
+    }
+    // the top bit picks the power of two, the next two bits pick the quarter of it
+    unsigned int topBit{static_cast<unsigned int>(bit_width(value)) - 1};
+    return (topBit - 1) * HISTOGRAM_SUB_BUCKETS + ((value >> (topBit - 2)) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+// the smallest value that lands in bucket
+auto BucketStart(unsigned int bucket) -> uint64_t
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    unsigned int topBit{bucket / HISTOGRAM_SUB_BUCKETS + 1};
+    return static_cast<uint64_t>(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << (topBit - 2);
+}
+
+auto AddSample(logHistogram &histogram, uint64_t value) -> void
+{
+    uint32_t clamped{static_cast<uint32_t>(min<uint64_t>(value, UINT32_MAX))};
+    histogram.counts[HistogramBucket(clamped)] += 1;
+    histogram.total += 1;
+    histogram.sum += clamped;
+}
+
+auto MergeHistogram(logHistogram &into, const logHistogram &from) -> void
+{
+    for (unsigned int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        into.counts[bucket] += from.counts[bucket];
+    }
+    into.total += from.total;
+    into.sum += from.sum;
+}
+
+// roughly the value fraction of the samples are at or below (the middle of its bucket)
+auto HistogramQuantile(const logHistogram &histogram, double fraction) -> uint64_t
+{
+    uint64_t wanted{max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * histogram.total)))};
+    uint64_t seen{0};
+    for (unsigned int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        seen += histogram.counts[bucket];
+        if (seen >= wanted)
+        {
+            return (BucketStart(bucket) + (bucket + 1 < HISTOGRAM_BUCKETS ? BucketStart(bucket + 1) : UINT32_MAX + 1ULL) - 1) / 2;
+        }
+    }
+    return 0;
+}
+
+auto WordsPerMinute(uint64_t letters, uint64_t ticks) -> unsigned int
+{
+    uint64_t elapsedMs{ticks * SIMULATION_STEP_MS};
+    return elapsedMs == 0 ? 0 : static_cast<unsigned int>(letters * 60000 / (LETTERS_PER_WORD * elapsedMs));
+}
+
+// whole percent, 100 before anything has been typed
+auto AccuracyPercent(const typingStats &stats) -> unsigned int
+{
+    return stats.keystrokes == 0 ? 100 : static_cast<unsigned int>(stats.accurateKeys * 100 / stats.keystrokes);
+}
+
+auto RecordKeystroke(typingStats &stats, int64_t nowUs, bool accurate) -> void
+{
+    stats.keystrokes += 1;
+    stats.accurateKeys += accurate;
+    if (stats.lastKeyUs >= 0)
+    {
+        AddSample(stats.keyIntervalUs, nowUs - stats.lastKeyUs);
+    }
+    stats.lastKeyUs = nowUs;
+}
+
+// a word went, either typed out (cleared) or off the edge; ticksOnScreen is how long it was out
+auto RecordWordGone(typingStats &stats, int length, unsigned int colour, unsigned int ticksOnScreen, bool cleared) -> void
+{
+    if (not cleared)
+    {
+        stats.wordsMissed += 1;
+        return;
+    }
+    uint64_t clearMs{static_cast<uint64_t>(ticksOnScreen) * SIMULATION_STEP_MS};
+    stats.wordsCleared += 1;
+    stats.lettersCleared += length;
+    AddSample(stats.clearMsByLength[clamp<int>(length, 1, TRACKED_WORD_LENGTHS) - 1], clearMs);
+    AddSample(stats.clearMsByStage[colour == COLOUR_RED ? 2 : colour == COLOUR_YELLOW ? 1 : 0], clearMs);
+}
+
+// adds a finished session (which ran for ticks) into the totals
+auto MergeTypingStats(typingStats &into, const typingStats &from, uint64_t ticks) -> void
+{
+    into.keystrokes += from.keystrokes;
+    into.accurateKeys += from.accurateKeys;
+    into.wordsCleared += from.wordsCleared;
+    into.wordsMissed += from.wordsMissed;
+    into.lettersCleared += from.lettersCleared;
+    into.ticksPlayed += ticks;
+    into.sessions += 1;
+    MergeHistogram(into.keyIntervalUs, from.keyIntervalUs);
+    for (unsigned int length = 0; length < TRACKED_WORD_LENGTHS; length++)
+    {
+        MergeHistogram(into.clearMsByLength[length], from.clearMsByLength[length]);
+    }
+    for (unsigned int stage = 0; stage < COLOUR_STAGES; stage++)
+    {
+        MergeHistogram(into.clearMsByStage[stage], from.clearMsByStage[stage]);
+    }
+    AddSample(into.sessionWpm, WordsPerMinute(from.lettersCleared, ticks));
+}
+
+// count, mean and a few percentiles on one line
+auto PrintHistogram(ostream &output, const char *label, const logHistogram &histogram, uint64_t divisor = 1) -> void
+{
+    if (histogram.total == 0)
+    {
+        return;
+    }
+    output << "  " << label << ": n " << histogram.total << " mean " << histogram.sum / histogram.total / divisor;
+    for (auto [name, fraction] : {pair{"p50", 0.5}, pair{"p90", 0.9}, pair{"p99", 0.99}})
+    {
+        output << " " << name << " " << HistogramQuantile(histogram, fraction) / divisor;
+    }
+    output << endl;
+}
+
+// the summary written when the program exits
+auto PrintTypingStats(ostream &output, const typingStats &stats) -> void
+{
+    output << "typing: " << stats.sessions << " sessions, " << stats.keystrokes << " keys, "
+           << AccuracyPercent(stats) << "% accurate, " << WordsPerMinute(stats.lettersCleared, stats.ticksPlayed) << " wpm, "
+           << stats.wordsCleared << " words cleared, " << stats.wordsMissed << " missed" << endl;
+    PrintHistogram(output, "wpm per session", stats.sessionWpm);
+    PrintHistogram(output, "ms between keys", stats.keyIntervalUs, 1000);
+    const array<const char *, COLOUR_STAGES> STAGE_NAMES{"green", "yellow", "red"};
+    for (unsigned int stage = 0; stage < COLOUR_STAGES; stage++)
+    {
+        PrintHistogram(output, (string("ms to clear, cleared while ") + STAGE_NAMES[stage]).c_str(), stats.clearMsByStage[stage]);
+    }
+    for (unsigned int length = 0; length < TRACKED_WORD_LENGTHS; length++)
+    {
+        string label{"ms to clear, length " + to_string(length + 1) + (length + 1 == TRACKED_WORD_LENGTHS ? "+" : "")};
+        PrintHistogram(output, label.c_str(), stats.clearMsByLength[length]);
+    }
+}
+
+// Input Ring
+// Everything waiting on stdin is read with one read() and pushed into a
+// single-producer / single-consumer ring buffer, which the game logic drains.
+// Only the producer writes head and only the consumer writes tail, so the two
+// sides never need a lock and the reading could move to its own thread later.
+// Every char is stamped with when it was read, so keys that wait a while in the
+// ring (or get handled in one batch) still keep the time between them.
+
+const size_t INPUT_RING_CAPACITY{1024}; // power of two so wrapping around is just a mask
+
+// the steady clock in microseconds, what keystrokes are stamped with
+auto MicrosecondsNow() -> int64_t
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct inputRing
+{
+    array<char, INPUT_RING_CAPACITY> buffer{};
+    array<int64_t, INPUT_RING_CAPACITY> arrivedUs{}; // when each char was read
+    // these only ever count up; kept on separate cache lines so the two sides don't fight
+    alignas(64) atomic<size_t> head{0}; // total chars pushed (written by the producer)
+    alignas(64) atomic<size_t> tail{0}; // total chars popped (written by the consumer)
+};
+
+// producer side: returns how many chars fit (they all arrived at arrivedUs)
+auto PushInput(inputRing &ring, const char *data, size_t length, int64_t arrivedUs) -> size_t
+{
+    size_t head{ring.head.load(memory_order_relaxed)};
+    size_t tail{ring.tail.load(memory_order_acquire)};
+    size_t count{min(length, INPUT_RING_CAPACITY - (head - tail))};
+    for (size_t i = 0; i < count; i++)
+    {
+        ring.buffer[(head + i) & (INPUT_RING_CAPACITY - 1)] = data[i];
+        ring.arrivedUs[(head + i) & (INPUT_RING_CAPACITY - 1)] = arrivedUs;
+    }
+    // publish the chars only after they've been written
+    ring.head.store(head + count, memory_order_release);
+    return count;
+}
+
+// consumer side: false once the ring is empty
+auto PopInput(inputRing &ring, char &nextChar, int64_t &arrivedUs) -> bool
+{
+    size_t tail{ring.tail.load(memory_order_relaxed)};
+    if (tail == ring.head.load(memory_order_acquire))
+    {
+        return false;
+    }
+    nextChar = ring.buffer[tail & (INPUT_RING_CAPACITY - 1)];
+    arrivedUs = ring.arrivedUs[tail & (INPUT_RING_CAPACITY - 1)];
+    ring.tail.store(tail + 1, memory_order_release);
+    return true;
+}
+
+// reads everything that's waiting (up to the free space in the ring) in a single read()
+// returns the number of chars read, 0 when the input was closed, -1 when nothing was waiting
+auto PumpInput(int inputFd, inputRing &ring) -> long
+{
+    size_t freeSpace{INPUT_RING_CAPACITY - (ring.head.load(memory_order_relaxed) - ring.tail.load(memory_order_acquire))};
+    if (freeSpace == 0)
+    {
+        // leave the rest in the kernel until the game catches up
+        return -1;
+    }
+    char chunk[INPUT_RING_CAPACITY];
+    auto bytesRead{read(inputFd, chunk, freeSpace)};
+    if (bytesRead > 0)
+    {
+        PushInput(ring, chunk, bytesRead, MicrosecondsNow());
+    }
+    return bytesRead;
+}
+
+// Dictionary Lookups
+
+auto WordAt(const dictionary &wordList, unsigned int number) -> string_view
+{
+    return string_view(wordList.text + wordList.offsets[number], wordList.entries[number].length);
+}
+
+// FNV-1a over every word, so recordings and snapshots can tell they've been given a different word list
+auto DictionaryFingerprint(const dictionary &wordList) -> uint64_t
+{
+    uint64_t hash{14695981039346656037ULL};
+    for (unsigned int number = 0; number < wordList.wordCount; number++)
+    {
+        for (char letter : WordAt(wordList, number))
+        {
+            hash = (hash ^ static_cast<uint8_t>(letter)) * 1099511628211ULL;
+        }
+        hash = (hash ^ '\n') * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// the number of the dictionary word that content points at (offsets only ever go up)
+auto WordNumberOf(const dictionary &wordList, string_view content) -> unsigned int
+{
+    uint32_t offset{static_cast<uint32_t>(content.data() - wordList.text)};
+    return upper_bound(wordList.offsets, wordList.offsets + wordList.wordCount, offset) - wordList.offsets - 1;
+}
+
+auto PickWord(const dictionary &wordList, default_random_engine &randomEngine) -> unsigned int
+{
+    uniform_int_distribution<unsigned int> wordindex(0, wordList.wordCount - 1);
+    return wordindex(randomEngine);
+}
+
+// picks out of one bucket, so it costs the same however big the dictionary is
+// returns -1 when there are no words in that bucket
+auto PickFromBucket(const uint32_t *starts, const uint32_t *bucketWords, unsigned int bucket, default_random_engine &randomEngine) -> int
+{
+    uint32_t first{starts[bucket]};
+    uint32_t last{starts[bucket + 1]};
+    if (first == last)
+    {
+        return -1;
+    }
+    uniform_int_distribution<uint32_t> bucketindex(first, last - 1);
+    return static_cast<int>(bucketWords[bucketindex(randomEngine)]);
+}
+
+auto PickWordOfLength(const dictionary &wordList, unsigned int length, default_random_engine &randomEngine) -> int
+{
+    if (length > wordList.maxLength)
+    {
+        return -1;
+    }
+    return PickFromBucket(wordList.lengthStarts, wordList.byLength, length, randomEngine);
+}
+
+auto PickWordOfDifficulty(const dictionary &wordList, unsigned int difficulty, default_random_engine &randomEngine) -> int
+{
+    if (difficulty >= DIFFICULTY_LEVELS)
+    {
+        return -1;
+    }
+    return PickFromBucket(wordList.difficultyStarts, wordList.byDifficulty, difficulty, randomEngine);
+}
+
+// sizes every array for the most words we'll ever hold, so adding words never allocates
+auto InitWordStore(wordStore &words, unsigned int capacity) -> void
+{
+    words.count = 0;
+    words.capacity = capacity;
+    words.content.assign(capacity, string_view());
+    words.length.assign(capacity, 0);
+    words.width.assign(capacity, 0);
+    words.codePoints.assign(capacity, 0);
+    words.row.assign(capacity, 0);
+    words.col.assign(capacity, 0);
+    words.position.assign(capacity, 0);
+    words.speed.assign(capacity, 0);
+    words.colour.assign(capacity, COLOUR_IGNORE);
+    words.cleared.assign(capacity, false);
+    words.bornTick.assign(capacity, 0);
+}
+
+// adds a word to the end of the store, returns false if the store is already full
+auto AddWord(wordStore &words, string_view content, const dictionaryEntry &entry, int row, int col, int speed, unsigned int colour, unsigned int tick) -> bool
+{
+    if (words.count == words.capacity)
+    {
+        return false;
+    }
+    unsigned int slot{words.count};
+    words.content[slot] = content;
+    words.length[slot] = static_cast<int>(content.length());
+    words.width[slot] = entry.width;
+    words.codePoints[slot] = entry.codePoints;
+    words.row[slot] = row;
+    words.col[slot] = col;
+    words.position[slot] = col << SUBCELL_BITS;
+    words.speed[slot] = speed;
+    words.colour[slot] = colour;
+    words.cleared[slot] = false;
+    words.bornTick[slot] = tick;
+    words.count += 1;
+    return true;
+}
+
+// Lanes
+// Every row of the play area is a lane. New words appear just inside the left border, so
+// a lane can take one once the word that entered it last has moved far enough along to
+// leave room for it (plus a gap). freeLanes has a bit set for each lane with room for a
+// word up to LANE_ROOM wide, so finding one is a few bit scans however many words are out;
+// a wider word looks on through the free lanes for one it fits. A word never enters a lane
+// going faster than the word in front of it, so words sharing a lane can't catch each
+// other up and overlap. When a lane's last word goes, the clear pass picks up whichever
+// of that lane's words is now furthest back, without looking at the other lanes.
+
+const int LANE_GAP{2};   // blank columns between a word and the next one into its lane
+const int LANE_ROOM{8};  // a lane is free once a word this wide fits behind its last one
+const int LOST_TAIL{-2}; // tailSlot of a lane whose last word is going, while a clear pass finds the next one
+
+struct laneAllocator
+{
+    int firstRow{2};
+    vector<int> tailSlot;       // per lane: wordStore slot of the word that entered it last, -1 if none is left
+    vector<uint64_t> freeLanes; // bit per lane, set when a new word can go in
+    vector<int> lostLanes;              // scratch: lanes whose last word went in this clear pass
+    vector<unsigned int> lostLaneWords; // scratch: the (compacted) slots of the words left in them
+};
+
+auto SetLaneFree(laneAllocator &lanes, int lane, bool isFree) -> void
+{
+    uint64_t bit{1ULL << (lane % 64)};
+    if (isFree)
+    {
+        lanes.freeLanes[lane / 64] |= bit;
+    }
+    else
+    {
+        lanes.freeLanes[lane / 64] &= ~bit;
+    }
+}
+
+// the tail word has to be this far along before another can follow it in
+auto LaneClearOf(const wordStore &words, unsigned int slot) -> bool
+{
+    return words.col[slot] >= 2 + LANE_ROOM + LANE_GAP;
+}
+
+// whether a word this wide can start at the left border of a lane without touching its last word
+auto LaneFits(const laneAllocator &lanes, const wordStore &words, int lane, int width) -> bool
+{
+    int tail{lanes.tailSlot[lane]};
+    return tail < 0 or words.col[tail] >= 2 + width + LANE_GAP;
+}
+
+// every lane empty, one per row the words move along
+auto ResetLanes(laneAllocator &lanes, const playLayout &layout) -> void
+{
+    int laneCount{layout.fieldHeight - 2};
+    lanes.firstRow = 2;
+    lanes.tailSlot.assign(laneCount, -1);
+    lanes.freeLanes.assign((laneCount + 63) / 64, 0);
+    for (int lane = 0; lane < laneCount; lane++)
+    {
+        SetLaneFree(lanes, lane, true);
+    }
+}
+
+// works the lanes out again from scratch, for when the words have all been moved (resize)
+auto RebuildLanes(laneAllocator &lanes, const wordStore &words, const playLayout &layout) -> void
+{
+    ResetLanes(lanes, layout);
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        int &tail{lanes.tailSlot[words.row[i] - lanes.firstRow]};
+        if (tail < 0 or words.col[i] < words.col[tail])
+        {
+            tail = static_cast<int>(i);
+        }
+    }
+    for (unsigned int lane = 0; lane < lanes.tailSlot.size(); lane++)
+    {
+        int tail{lanes.tailSlot[lane]};
+        SetLaneFree(lanes, lane, tail < 0 or LaneClearOf(words, tail));
+    }
+}
+
+// first free lane at or after start (wrapping around), -1 if every lane is busy
+auto FindFreeLane(const laneAllocator &lanes, int start) -> int
+{
+    int laneCount{static_cast<int>(lanes.tailSlot.size())};
+    int blockCount{static_cast<int>(lanes.freeLanes.size())};
+    for (int step = 0; step <= blockCount; step++)
+    {
+        int block{(start / 64 + step) % blockCount};
+        uint64_t bits{lanes.freeLanes[block]};
+        if (step == 0)
+        {
+            bits &= ~0ULL << (start % 64); // lanes before start are looked at last
+        }
+        else if (step == blockCount)
+        {
+            bits &= (start % 64 == 0) ? 0 : ~0ULL >> (64 - start % 64);
+        }
+        if (bits != 0)
+        {
+            int lane{block * 64 + countr_zero(bits)};
+            return lane < laneCount ? lane : -1;
+        }
+    }
+    return -1;
+}
+
+// before a clear pass: takes the lanes whose last word is going out of the running, goes(slot)
+// says whether a word is going, returns true if any were
+template <typename goesType>
+auto MarkLostTails(laneAllocator &lanes, goesType goes) -> bool
+{
+    lanes.lostLanes.clear();
+    lanes.lostLaneWords.clear();
+    for (unsigned int lane = 0; lane < lanes.tailSlot.size(); lane++)
+    {
+        int tail{lanes.tailSlot[lane]};
+        if (tail >= 0 and goes(static_cast<unsigned int>(tail)))
+        {
+            lanes.tailSlot[lane] = LOST_TAIL;
+            lanes.lostLanes.push_back(static_cast<int>(lane));
+        }
+    }
+    return not lanes.lostLanes.empty();
+}
+
+// after a clear pass: each marked lane's tail is whichever word left in it is furthest back
+auto ReplaceLostTails(laneAllocator &lanes, const wordStore &words) -> void
+{
+    for (auto slot : lanes.lostLaneWords)
+    {
+        int &tail{lanes.tailSlot[words.row[slot] - lanes.firstRow]};
+        if (tail == LOST_TAIL or words.col[slot] < words.col[tail])
+        {
+            tail = static_cast<int>(slot);
+        }
+    }
+    for (int lane : lanes.lostLanes)
+    {
+        int &tail{lanes.tailSlot[lane]};
+        if (tail == LOST_TAIL)
+        {
+            tail = -1;
+        }
+        SetLaneFree(lanes, lane, tail < 0 or LaneClearOf(words, tail));
+    }
+}
+
+// moves words first to last - 1 on by one simulation step, returns true if any of them moved
+// a whole column or changed colour (i.e. the screen needs redrawing)
+// how far a word goes for its speed is up to the game mode's movement rule, and laneFreed
+// is called with each lane whose last word just got far enough in for the next one
+template <typename movement, typename laneFreedType>
+auto MoveWordRange(wordStore &words, const laneAllocator &lanes, const playLayout &layout, unsigned int tick, unsigned int first, unsigned int last, laneFreedType laneFreed) -> bool
+{
+    bool changed{false};
+    // Update the position of each word
+    for (unsigned int i = first; i < last; i++)
+    {
+        int wordWidth{words.width[i]};
+        // each word moves right at its own speed, usually only part of a column per step
+        words.position[i] += movement::Step(words.speed[i], tick);
+        // temporarily store the column (so we can ensure it's within the boundary)
+        int proposedCol{words.position[i] >> SUBCELL_BITS};
+        unsigned int colour{words.colour[i]};
+
+        //check if word at certain location, if it is change word colour
+        if (proposedCol < layout.redStart and proposedCol >= layout.yellowStart)
+        {
+            colour = COLOUR_YELLOW;
+        }
+        else if (proposedCol >= layout.redStart)
+        {
+            colour = COLOUR_RED;
+        }
+
+        // moves right -- boundary of fieldWidth - wordWidth so the ends of the words hit a boundary instead of a beginning
+        int newCol{min((layout.fieldWidth - wordWidth), proposedCol)};
+        changed = changed or newCol != words.col[i] or colour != words.colour[i];
+        bool wasClear{LaneClearOf(words, i)};
+        words.col[i] = newCol;
+        words.colour[i] = colour;
+        // the last word into a lane just moved far enough along for the next one
+        int lane{words.row[i] - lanes.firstRow};
+        if (not wasClear and lanes.tailSlot[lane] == static_cast<int>(i) and LaneClearOf(words, i))
+        {
+            laneFreed(lane);
+        }
+    }
+    return changed;
+}
+
+// moves every word on by one simulation step, returns true if the screen needs redrawing
+template <typename movement>
+auto UpdateWordColumnPositions(wordStore &words, laneAllocator &lanes, const playLayout &layout, unsigned int tick) -> bool
+{
+    return MoveWordRange<movement>(words, lanes, layout, tick, 0, words.count, [&lanes](int lane)
+                                   { SetLaneFree(lanes, lane, true); });
+}
+
+// keeps the lookup in step with the wordStore: the word at oldIndex now lives at newIndex
+auto MoveIndexedWord(wordlookup &index, string_view content, unsigned int oldIndex, unsigned int newIndex) -> void
+{
+    for (auto &position : index[content])
+    {
+        if (position == oldIndex)
+        {
+            position = newIndex;
+            return;
+        }
+    }
+}
+
+auto RemoveIndexedWord(wordlookup &index, string_view content, unsigned int oldIndex) -> void
+{
+    auto entry{index.find(content)};
+    if (entry == index.end())
+    {
+        return;
+    }
+    auto &positions{entry->second};
+    positions.erase(find(positions.begin(), positions.end(), oldIndex));
+    if (positions.empty())
+    {
+        index.erase(entry);
+    }
+}
+
+// forgets what was typed (the first byte buckets follow the words, not the typing)
+auto ResetMatcher(prefixMatcher &matcher) -> void
+{
+    matcher.prefix.clear();
+    matcher.candidates.clear();
+}
+
+// new words always go on the end of the store, so each bucket stays in order
+auto AddFirstByteWord(prefixMatcher &matcher, string_view content, unsigned int slot) -> void
+{
+    matcher.byFirstByte[static_cast<unsigned char>(content[0])].push_back(slot);
+}
+
+// words from firstMoved on have been removed or shuffled down: drops them from the
+// buckets and puts the survivors back in at their new slots (the words before are untouched)
+auto RefillFirstByteBuckets(prefixMatcher &matcher, const wordStore &words, unsigned int firstMoved) -> void
+{
+    for (auto &bucket : matcher.byFirstByte)
+    {
+        bucket.erase(lower_bound(bucket.begin(), bucket.end(), firstMoved), bucket.end());
+    }
+    for (unsigned int i = firstMoved; i < words.count; i++)
+    {
+        AddFirstByteWord(matcher, words.content[i], i);
+    }
+}
+
+// narrows the candidates down by one typed character
+// the first one starts from the words beginning with it, after that only the survivors are checked
+auto AdvanceMatcher(prefixMatcher &matcher, const wordStore &words, char typed) -> void
+{
+    size_t position{matcher.prefix.length()};
+    matcher.prefix += typed;
+    if (position == 0)
+    {
+        for (auto i : matcher.byFirstByte[static_cast<unsigned char>(typed)])
+        {
+            if (not words.cleared[i])
+            {
+                matcher.candidates.push_back(i);
+            }
+        }
+        return;
+    }
+    unsigned int kept{0};
+    for (auto candidate : matcher.candidates)
+    {
+        string_view content{words.content[candidate]};
+        if (content.length() > position and content[position] == typed)
+        {
+            matcher.candidates[kept] = candidate;
+            kept += 1;
+        }
+    }
+    matcher.candidates.resize(kept);
+}
+
+// marks any candidate that has been typed out in full as cleared, returns true if there were any
+// (only once no longer word still matches, so "car" on screen doesn't stop "cart" being typed;
+// until then enter clears the shorter one)
+auto ClearCompletedWords(prefixMatcher &matcher, wordStore &words) -> bool
+{
+    for (auto candidate : matcher.candidates)
+    {
+        if (words.length[candidate] > static_cast<int>(matcher.prefix.length()))
+        {
+            return false;
+        }
+    }
+    bool completed{false};
+    for (auto candidate : matcher.candidates)
+    {
+        words.cleared[candidate] = true;
+        completed = true;
+    }
+    return completed;
+}
+
+// creates word in the store, pickWord(randomEngine) says which dictionary word it is
+template <typename pickType>
+auto CreateWord(wordStore &words, wordlookup &index, prefixMatcher &matcher, laneAllocator &lanes, const dictionary &wordList, default_random_engine &randomEngine, unsigned int tick, pickType pickWord) -> void
+{
+    // distribution to pick starting row from (limit to box dimensions), the nearest free lane from there is used
+    uniform_int_distribution<int> startlane(0, static_cast<int>(lanes.tailSlot.size()) - 1);
+    int lane{FindFreeLane(lanes, startlane(randomEngine))};
+    if (lane < 0)
+    {
+        // every lane is still busy at the left edge, skip this one
+        return;
+    }
+    //cerr << "Creating word" << endl;
+    // init new words with a random word and start position
+    // pick a word from the list
+    unsigned int number{pickWord(randomEngine)};
+    string_view content{WordAt(wordList, number)};
+    const dictionaryEntry &entry{wordList.entries[number]};
+    // a free lane only promises room for LANE_ROOM columns, a wider word looks on for one it fits
+    int firstLane{lane};
+    while (not LaneFits(lanes, words, lane, entry.width))
+    {
+        lane = FindFreeLane(lanes, (lane + 1) % static_cast<int>(lanes.tailSlot.size()));
+        if (lane == firstLane)
+        {
+            // no lane has room for it yet, skip this one
+            return;
+        }
+    }
+    int row{lanes.firstRow + lane};
+    // anywhere from 3/4 to 5/4 of the original speed, but never faster than the word in front
+    uniform_int_distribution<int> startspeed(BASE_WORD_SPEED * 3 / 4, BASE_WORD_SPEED * 5 / 4);
+    int speed{startspeed(randomEngine)};
+    if (lanes.tailSlot[lane] >= 0)
+    {
+        speed = min(speed, words.speed[lanes.tailSlot[lane]]);
+    }
+    unsigned int slot{words.count};
+    // starts just inside the left border
+    if (not AddWord(words, content, entry, row, 2, speed, COLOUR_GREEN, tick))
+    {
+        // screen is already as full as it can get, skip this one
+        return;
+    }
+    lanes.tailSlot[lane] = static_cast<int>(slot);
+    SetLaneFree(lanes, lane, false);
+    index[content].push_back(slot);
+    AddFirstByteWord(matcher, content, slot);
+    // a word that appears halfway through typing can still be matched
+    if (not matcher.prefix.empty() and content.starts_with(matcher.prefix))
+    {
+        matcher.candidates.push_back(slot);
+    }
+}
+
+// draws all active words into the back buffer, with the typed part of any candidates highlighted
+auto DisplayWords(screenBuffer &screen, const wordStore &words, const prefixMatcher &matcher) -> void
+{
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        DrawText(screen, words.row[i], words.col[i], words.content[i], words.colour[i]);
+    }
+    for (auto candidate : matcher.candidates)
+    {
+        DrawText(screen, words.row[candidate], words.col[candidate], matcher.prefix, COLOUR_TYPED);
+    }
+}
+
+// a word goes once it's been typed or its end reaches the right boundary
+// (fieldWidth is column boundary, account for different width words)
+auto WordGoes(const wordStore &words, const playLayout &layout, unsigned int slot) -> bool
+{
+    return words.cleared[slot] or words.col[slot] >= (layout.fieldWidth - words.width[slot]);
+}
+
+// removes words from the store when they are cleared or reach the boundary
+// survivors are shuffled down in one pass so nothing gets skipped after a removal
+// (what a word is worth and what a miss costs come from the game mode)
+template <typename scoring, typename lifeRules>
+auto ClearWords(wordStore &words, wordlookup &index, prefixMatcher &matcher, laneAllocator &lanes, const playLayout &layout, unsigned int &score, unsigned int &lives, typingStats &stats, unsigned int tick) -> void
+{
+    // index never negative so use unsigned
+    unsigned int kept{0};
+    // candidates are in the same order as the store, so they can be fixed up as we go
+    unsigned int candidate{0};
+    unsigned int keptCandidates{0};
+    unsigned int firstMoved{UINT_MAX}; // where the first word went, everything after it moves down
+    // the next word into a lane has to keep behind whichever one is left at the back
+    bool lostTail{MarkLostTails(lanes, [&](unsigned int slot)
+                                { return WordGoes(words, layout, slot); })};
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        int wordWidth{words.width[i]};
+        bool isCandidate{candidate < matcher.candidates.size() and matcher.candidates[candidate] == i};
+        if (isCandidate)
+        {
+            candidate += 1;
+        }
+        int &laneTail{lanes.tailSlot[words.row[i] - lanes.firstRow]};
+        if (WordGoes(words, layout, i))
+        {
+            if (words.cleared[i])
+            {
+                //cerr << "erased: " << words.content[i] << endl;
+                score += scoring::Points(words.codePoints[i], words.colour[i]);
+            }
+            else
+            { // two words can hit the boundary in the same step
+                lives -= min(lives, lifeRules::LIVES_PER_MISS);
+            }
+            RecordWordGone(stats, words.codePoints[i], words.colour[i], tick - words.bornTick[i], words.cleared[i]);
+            RemoveIndexedWord(index, words.content[i], i);
+            firstMoved = min(firstMoved, i);
+            continue;
+        }
+        if (laneTail == static_cast<int>(i))
+        {
+            laneTail = static_cast<int>(kept);
+        }
+        else if (laneTail == LOST_TAIL)
+        {
+            lanes.lostLaneWords.push_back(kept);
+        }
+        if (kept != i)
+        {
+            MoveIndexedWord(index, words.content[i], i, kept);
+            words.content[kept] = words.content[i];
+            words.length[kept] = words.length[i];
+            words.width[kept] = wordWidth;
+            words.codePoints[kept] = words.codePoints[i];
+            words.row[kept] = words.row[i];
+            words.col[kept] = words.col[i];
+            words.position[kept] = words.position[i];
+            words.speed[kept] = words.speed[i];
+            words.colour[kept] = words.colour[i];
+            words.cleared[kept] = false;
+            words.bornTick[kept] = words.bornTick[i];
+        }
+        if (isCandidate)
+        {
+            matcher.candidates[keptCandidates] = kept;
+            keptCandidates += 1;
+        }
+        kept += 1;
+    }
+    words.count = kept;
+    matcher.candidates.resize(keptCandidates);
+    if (firstMoved != UINT_MAX)
+    {
+        RefillFirstByteBuckets(matcher, words, firstMoved);
+    }
+    if (lostTail)
+    {
+        ReplaceLostTails(lanes, words);
+    }
+}
+
+// Parallel Tick
+// A session with a huge number of words (tens of thousands) can spread the move and
+// clear passes over a pool of threads. The words are cut into fixed size chunks and
+// each chunk is moved, then classified (kept or gone), on whichever thread picks it up.
+// The survivors' new slots come from a prefix sum over the chunks' kept counts, so every
+// chunk can copy its survivors into a spare wordStore at the same time, and the two are
+// swapped afterwards. Anything that isn't per word (freeing lanes, the score, the stats,
+// the matcher) is gathered per chunk and applied afterwards in chunk order, so the result
+// is exactly what the single threaded pass gives, however many threads there are.
+// Below PARALLEL_TICK_WORDS waking the threads costs more than it saves, so smaller
+// sessions (which is every normal game) always take the single threaded pass.
+
+const unsigned int PARALLEL_TICK_WORDS{16384}; // fewest words before a tick is worth splitting up
+const unsigned int TICK_CHUNK_WORDS{4096};
+const unsigned int TICK_CHUNK_BUCKETS{4096}; // word index buckets remapped per chunk
+
+// fork / join: ParallelFor hands out chunk numbers until they're all done, and the
+// thread that called it works through them too (so a pool with no workers just runs
+// everything itself)
+struct tickPool
+{
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wakeUp;
+    condition_variable finished;
+    unsigned long long generation{0}; // bumped for every job
+    unsigned int busyWorkers{0};
+    bool stopping{false};
+    auto (*run)(void *job, unsigned int chunk) -> void {nullptr};
+    void *job{nullptr};
+    unsigned int chunkCount{0};
+    atomic<unsigned int> nextChunk{0};
+};
+
+auto RunChunks(tickPool &pool) -> void
+{
+    for (unsigned int chunk = pool.nextChunk.fetch_add(1); chunk < pool.chunkCount; chunk = pool.nextChunk.fetch_add(1))
+    {
+        pool.run(pool.job, chunk);
+    }
+}
+
+auto RunTickWorker(tickPool &pool) -> void
+{
+    unsigned long long seen{0};
+    unique_lock<mutex> guard(pool.lock);
+    while (true)
+    {
+        pool.wakeUp.wait(guard, [&pool, seen]
+                         { return pool.stopping or pool.generation != seen; });
+        if (pool.stopping)
+        {
+            return;
+        }
+        seen = pool.generation;
+        guard.unlock();
+        RunChunks(pool);
+        guard.lock();
+        pool.busyWorkers -= 1;
+        if (pool.busyWorkers == 0)
+        {
+            pool.finished.notify_one();
+        }
+    }
+}
+
+// threadCount includes the thread that calls ParallelFor
+auto StartTickPool(tickPool &pool, unsigned int threadCount) -> void
+{
+    for (unsigned int number = 1; number < threadCount; number++)
+    {
+        pool.workers.emplace_back(RunTickWorker, ref(pool));
+    }
+}
+
+auto StopTickPool(tickPool &pool) -> void
+{
+    {
+        lock_guard<mutex> guard(pool.lock);
+        pool.stopping = true;
+    }
+    pool.wakeUp.notify_all();
+    for (auto &worker : pool.workers)
+    {
+        worker.join();
+    }
+    pool.workers.clear();
+}
+
+// calls body(chunk) for every chunk from 0 to chunkCount - 1, spread over the pool, and
+// returns once they've all finished (body is only borrowed, so nothing is allocated)
+template <typename bodyType>
+auto ParallelFor(tickPool &pool, unsigned int chunkCount, bodyType &body) -> void
+{
+    {
+        lock_guard<mutex> guard(pool.lock);
+        pool.run = [](void *job, unsigned int chunk)
+        { (*static_cast<bodyType *>(job))(chunk); };
+        pool.job = &body;
+        pool.chunkCount = chunkCount;
+        pool.nextChunk.store(0);
+        pool.busyWorkers = pool.workers.size();
+        pool.generation += 1;
+    }
+    pool.wakeUp.notify_all();
+    RunChunks(pool);
+    unique_lock<mutex> guard(pool.lock);
+    pool.finished.wait(guard, [&pool]
+                       { return pool.busyWorkers == 0; });
+}
+
+// what one chunk found, applied once every chunk is done
+struct tickChunk
+{
+    bool changed{false};
+    vector<int> freedLanes;
+    unsigned int kept{0};
+    unsigned int firstKept{0}; // where this chunk's survivors start in the compacted store
+    unsigned int points{0};
+    unsigned int misses{0};
+    vector<unsigned int> gone; // slots of the words that went, in order
+    vector<unsigned int> laneWords; // compacted slots of the survivors in lanes that lost their last word
+    vector<string_view> emptied; // index entries with no words left
+};
+
+// the pool a session's ticks can use, plus scratch space kept between ticks so they don't allocate
+struct parallelTick
+{
+    tickPool *pool{nullptr}; // nullptr (the default) always runs single threaded
+    vector<tickChunk> chunks;
+    vector<int> newSlot; // per old slot: where it went in the compacted store, -1 if it's gone
+    wordStore spare;
+};
+
+auto UseParallelTick(const parallelTick &parallel, const wordStore &words) -> bool
+{
+    return parallel.pool != nullptr and words.count >= PARALLEL_TICK_WORDS;
+}
+
+auto ChunkCount(unsigned int itemCount, unsigned int chunkSize) -> unsigned int
+{
+    return (itemCount + chunkSize - 1) / chunkSize;
+}
+
+template <typename movement>
+auto UpdateWordColumnPositionsParallel(wordStore &words, laneAllocator &lanes, const playLayout &layout, unsigned int tick, parallelTick &parallel) -> bool
+{
+    unsigned int chunkCount{ChunkCount(words.count, TICK_CHUNK_WORDS)};
+    if (parallel.chunks.size() < chunkCount)
+    {
+        parallel.chunks.resize(chunkCount);
+    }
+    auto moveChunk{[&](unsigned int chunk)
+                   {
+                       tickChunk &result{parallel.chunks[chunk]};
+                       result.freedLanes.clear();
+                       unsigned int first{chunk * TICK_CHUNK_WORDS};
+                       result.changed = MoveWordRange<movement>(words, lanes, layout, tick, first, min(words.count, first + TICK_CHUNK_WORDS), [&result](int lane)
+                                                                { result.freedLanes.push_back(lane); });
+                   }};
+    ParallelFor(*parallel.pool, chunkCount, moveChunk);
+    bool changed{false};
+    for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        changed = changed or parallel.chunks[chunk].changed;
+        for (int lane : parallel.chunks[chunk].freedLanes)
+        {
+            SetLaneFree(lanes, lane, true);
+        }
+    }
+    return changed;
+}
+
+// ClearWords spread over the pool, leaves everything exactly as ClearWords would
+template <typename scoring, typename lifeRules>
+auto ClearWordsParallel(wordStore &words, wordlookup &index, prefixMatcher &matcher, laneAllocator &lanes, const playLayout &layout, unsigned int &score, unsigned int &lives, typingStats &stats, unsigned int tick, parallelTick &parallel) -> void
+{
+    unsigned int chunkCount{ChunkCount(words.count, TICK_CHUNK_WORDS)};
+    if (parallel.chunks.size() < chunkCount)
+    {
+        parallel.chunks.resize(chunkCount);
+    }
+    if (parallel.spare.capacity != words.capacity)
+    {
+        InitWordStore(parallel.spare, words.capacity);
+    }
+    parallel.newSlot.resize(words.count);
+
+    // which words go, and how many each chunk keeps
+    auto classifyChunk{[&](unsigned int chunk)
+                       {
+                           tickChunk &result{parallel.chunks[chunk]};
+                           result.kept = 0;
+                           result.points = 0;
+                           result.misses = 0;
+                           result.gone.clear();
+                           unsigned int first{chunk * TICK_CHUNK_WORDS};
+                           for (unsigned int i = first; i < min(words.count, first + TICK_CHUNK_WORDS); i++)
+                           {
+                               if (WordGoes(words, layout, i))
+                               {
+                                   if (words.cleared[i])
+                                   {
+                                       result.points += scoring::Points(words.codePoints[i], words.colour[i]);
+                                   }
+                                   else
+                                   {
+                                       result.misses += 1;
+                                   }
+                                   result.gone.push_back(i);
+                                   parallel.newSlot[i] = -1;
+                                   continue;
+                               }
+                               parallel.newSlot[i] = result.kept;
+                               result.kept += 1;
+                           }
+                       }};
+    ParallelFor(*parallel.pool, chunkCount, classifyChunk);
+    unsigned int kept{0};
+    for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        tickChunk &result{parallel.chunks[chunk]};
+        result.firstKept = kept;
+        kept += result.kept;
+        score += result.points;
+        lives -= min(lives, result.misses * lifeRules::LIVES_PER_MISS);
+        for (auto slot : result.gone)
+        {
+            RecordWordGone(stats, words.codePoints[slot], words.colour[slot], tick - words.bornTick[slot], words.cleared[slot]);
+        }
+    }
+    if (kept == words.count)
+    {
+        return;
+    }
+    // the next word into a lane has to keep behind whichever one is left at the back,
+    // each chunk notes the survivors in lanes that lost their last word
+    bool lostTail{MarkLostTails(lanes, [&](unsigned int slot)
+                                { return parallel.newSlot[slot] < 0; })};
+
+    // every chunk copies its survivors to where the prefix sum says they go
+    wordStore &spare{parallel.spare};
+    auto compactChunk{[&](unsigned int chunk)
+                      {
+                          tickChunk &result{parallel.chunks[chunk]};
+                          result.laneWords.clear();
+                          unsigned int first{chunk * TICK_CHUNK_WORDS};
+                          unsigned int firstKept{result.firstKept};
+                          for (unsigned int i = first; i < min(words.count, first + TICK_CHUNK_WORDS); i++)
+                          {
+                              if (parallel.newSlot[i] < 0)
+                              {
+                                  continue;
+                              }
+                              unsigned int slot{firstKept + parallel.newSlot[i]};
+                              parallel.newSlot[i] = slot;
+                              if (lostTail and lanes.tailSlot[words.row[i] - lanes.firstRow] == LOST_TAIL)
+                              {
+                                  result.laneWords.push_back(slot);
+                              }
+                              spare.content[slot] = words.content[i];
+                              spare.length[slot] = words.length[i];
+                              spare.width[slot] = words.width[i];
+                              spare.codePoints[slot] = words.codePoints[i];
+                              spare.row[slot] = words.row[i];
+                              spare.col[slot] = words.col[i];
+                              spare.position[slot] = words.position[i];
+                              spare.speed[slot] = words.speed[i];
+                              spare.colour[slot] = words.colour[i];
+                              spare.cleared[slot] = false;
+                              spare.bornTick[slot] = words.bornTick[i];
+                          }
+                      }};
+    ParallelFor(*parallel.pool, chunkCount, compactChunk);
+    spare.count = kept;
+    swap(words, spare);
+    for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        auto &laneWords{parallel.chunks[chunk].laneWords};
+        lanes.lostLaneWords.insert(lanes.lostLaneWords.end(), laneWords.begin(), laneWords.end());
+    }
+
+    // the index is fixed up a run of buckets at a time (only the positions change, so
+    // the table itself isn't touched until the emptied entries are erased)
+    unsigned int bucketChunks{ChunkCount(index.bucket_count(), TICK_CHUNK_BUCKETS)};
+    if (parallel.chunks.size() < bucketChunks)
+    {
+        parallel.chunks.resize(bucketChunks);
+    }
+    auto remapChunk{[&](unsigned int chunk)
+                    {
+                        tickChunk &result{parallel.chunks[chunk]};
+                        result.emptied.clear();
+                        size_t first{static_cast<size_t>(chunk) * TICK_CHUNK_BUCKETS};
+                        for (size_t bucket = first; bucket < min(index.bucket_count(), first + TICK_CHUNK_BUCKETS); bucket++)
+                        {
+                            for (auto entry = index.begin(bucket); entry != index.end(bucket); ++entry)
+                            {
+                                auto &positions{entry->second};
+                                unsigned int stillHere{0};
+                                for (auto position : positions)
+                                {
+                                    if (parallel.newSlot[position] >= 0)
+                                    {
+                                        positions[stillHere] = parallel.newSlot[position];
+                                        stillHere += 1;
+                                    }
+                                }
+                                positions.resize(stillHere);
+                                if (positions.empty())
+                                {
+                                    result.emptied.push_back(entry->first);
+                                }
+                            }
+                        }
+                    }};
+    ParallelFor(*parallel.pool, bucketChunks, remapChunk);
+    for (unsigned int chunk = 0; chunk < bucketChunks; chunk++)
+    {
+        for (auto content : parallel.chunks[chunk].emptied)
+        {
+            index.erase(content);
+        }
+    }
+
+    unsigned int keptCandidates{0};
+    for (auto candidate : matcher.candidates)
+    {
+        if (parallel.newSlot[candidate] >= 0)
+        {
+            matcher.candidates[keptCandidates] = parallel.newSlot[candidate];
+            keptCandidates += 1;
+        }
+    }
+    matcher.candidates.resize(keptCandidates);
+    // the first byte buckets are remapped the same way, a few buckets per thread
+    auto remapFirstByte{[&](unsigned int byte)
+                        {
+                            auto &bucket{matcher.byFirstByte[byte]};
+                            unsigned int stillHere{0};
+                            for (auto slot : bucket)
+                            {
+                                if (parallel.newSlot[slot] >= 0)
+                                {
+                                    bucket[stillHere] = parallel.newSlot[slot];
+                                    stillHere += 1;
+                                }
+                            }
+                            bucket.resize(stillHere);
+                        }};
+    ParallelFor(*parallel.pool, static_cast<unsigned int>(matcher.byFirstByte.size()), remapFirstByte);
+    for (auto &laneTail : lanes.tailSlot)
+    {
+        if (laneTail >= 0)
+        {
+            laneTail = parallel.newSlot[laneTail];
+        }
+    }
+    if (lostTail)
+    {
+        ReplaceLostTails(lanes, words);
+    }
+}
+
+const array<string_view, 2> TYPED_COMMANDS{"quit", "pause"};
+
+// true while what's been typed could still become a command, so no word gets cleared out from under it
+auto StartsCommand(string_view typed) -> bool
+{
+    for (auto command : TYPED_COMMANDS)
+    {
+        if (command.starts_with(typed))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// handles the typed commands, returns true if attempt was one (so it isn't matched against words)
+auto HandleCommand(const string &attempt, bool &quit, bool &paused) -> bool
+{
+    if (attempt == "quit")
+    {
+        quit = true;
+        return true;
+    }
+    if (attempt == "pause")
+    { // the same command carries on again
+        paused = not paused;
+        return true;
+    }
+    return false;
+}
+
+// marks every active word with exactly this content as cleared
+auto CheckMatchedWord(wordStore &words, const wordlookup &index, const string &attempt) -> void
+{
+    auto match{index.find(string_view(attempt))};
+    if (match == index.end())
+    {
+        return;
+    }
+    for (auto position : match->second)
+    {
+        words.cleared[position] = true;
+        //cerr << "cleared: " << attempt << endl;
+    }
+}
+
+// takes every keystroke waiting in the ring and applies it to the current command
+// while paused, only commands do anything (words can't be typed out)
+auto ConsumeInput(inputRing &input, wordStore &words, const wordlookup &index, prefixMatcher &matcher, string &currentCommand, bool &quit, bool &paused, typingStats &stats) -> void
+{
+    char currentChar;
+    int64_t arrivedUs;
+    while (PopInput(input, currentChar, arrivedUs))
+    {
+        if (currentChar == '\n') //checks the command once the user enters \n
+        {
+            // commands first, otherwise check if command matched in activeWords
+            if (not HandleCommand(currentCommand, quit, paused) and not paused)
+            {
+                CheckMatchedWord(words, index, currentCommand);
+            }
+            //cerr << currentCommand << endl;
+            currentCommand.clear();
+            ResetMatcher(matcher);
+        }
+        else if (currentChar == '\r')
+        { // telnet style clients send \r\n, the \n is enough
+            continue;
+        }
+        else if (paused)
+        {
+            currentCommand += currentChar;
+        }
+        else
+        {
+            currentCommand += currentChar;
+            AdvanceMatcher(matcher, words, currentChar);
+            RecordKeystroke(stats, arrivedUs, not matcher.candidates.empty());
+            // a word is cleared as soon as it's typed out, no need to press enter
+            // (unless a command is being typed, those are checked first on enter)
+            if (not StartsCommand(currentCommand) and ClearCompletedWords(matcher, words))
+            {
+                currentCommand.clear();
+                ResetMatcher(matcher);
+            }
+        }
+    }
+}
+
+// shows current score, lives and how well the player is typing
+auto ShowStats(screenBuffer &screen, int row, unsigned int score, unsigned int lives, unsigned int wordsPerMinute, unsigned int accuracy) -> void
+{
+    // the tab used to be expanded by the terminal, so each one lines up with the next tab stop
+    int col{1};
+    for (const string &text : {"score: " + to_string(score), "lives: " + to_string(lives),
+                               "wpm: " + to_string(wordsPerMinute), "accuracy: " + to_string(accuracy) + "%"})
+    {
+        DrawText(screen, row, col, text);
+        col += (text.length() / 8 + 1) * 8;
+    }
+}
+
+// maps a whole file read only, returns false if it can't be opened or is empty
+auto MapFile(const string &fileName, const char *&data, size_t &size) -> bool
+{
+    int fileDescriptor{open(fileName.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fileDescriptor < 0)
+    {
+        return false;
+    }
+    struct stat fileInfo;
+    if (fstat(fileDescriptor, &fileInfo) < 0 or fileInfo.st_size == 0)
+    {
+        close(fileDescriptor);
+        return false;
+    }
+    void *mapped{mmap(nullptr, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0)};
+    // the mapping stays valid after the file is closed
+    close(fileDescriptor);
+    if (mapped == MAP_FAILED)
+    {
+        cerr << "couldn't map " << fileName << " [" << errno << "]" << endl;
+        return false;
+    }
+    data = static_cast<const char *>(mapped);
+    size = fileInfo.st_size;
+    return true;
+}
+
+// words without a difficulty in the file get one from their length
+auto GuessDifficulty(unsigned int codePoints) -> uint8_t
+{
+    if (codePoints <= 4)
+    {
+        return 0;
+    }
+    if (codePoints <= 7)
+    {
+        return 1;
+    }
+    return 2;
+}
+
+// counting sort of every word number into buckets by key, starts[key] is where each bucket begins
+auto BuildBuckets(const vector<unsigned int> &keys, unsigned int bucketCount, vector<uint32_t> &starts, vector<uint32_t> &bucketWords) -> void
+{
+    starts.assign(bucketCount + 1, 0);
+    for (auto key : keys)
+    {
+        starts[key + 1] += 1;
+    }
+    for (unsigned int bucket = 0; bucket < bucketCount; bucket++)
+    {
+        starts[bucket + 1] += starts[bucket];
+    }
+    bucketWords.assign(keys.size(), 0);
+    vector<uint32_t> next(starts.begin(), starts.end() - 1);
+    for (unsigned int number = 0; number < keys.size(); number++)
+    {
+        bucketWords[next[keys[number]]] = number;
+        next[keys[number]] += 1;
+    }
+}
+
+// fills in the length / difficulty buckets once the offsets and entries are known
+auto BuildDictionaryTables(dictionary &wordList) -> void
+{
+    wordList.wordCount = wordList.ownedEntries.size();
+    wordList.maxLength = 0;
+    vector<unsigned int> lengths(wordList.wordCount);
+    vector<unsigned int> difficulties(wordList.wordCount);
+    for (unsigned int number = 0; number < wordList.wordCount; number++)
+    {
+        lengths[number] = wordList.ownedEntries[number].codePoints;
+        difficulties[number] = wordList.ownedEntries[number].difficulty;
+        wordList.maxLength = max(wordList.maxLength, lengths[number]);
+    }
+    BuildBuckets(lengths, wordList.maxLength + 1, wordList.ownedLengthStarts, wordList.ownedByLength);
+    BuildBuckets(difficulties, DIFFICULTY_LEVELS, wordList.ownedDifficultyStarts, wordList.ownedByDifficulty);
+
+    wordList.offsets = wordList.ownedOffsets.data();
+    wordList.entries = wordList.ownedEntries.data();
+    wordList.lengthStarts = wordList.ownedLengthStarts.data();
+    wordList.byLength = wordList.ownedByLength.data();
+    wordList.difficultyStarts = wordList.ownedDifficultyStarts.data();
+    wordList.byDifficulty = wordList.ownedByDifficulty.data();
+}
+
+// function to load file
+// maps the whole file in one go and records where each line starts and ends,
+// returns false if the file couldn't be read or has no words in it
+auto LoadWordList(string fileName, dictionary &wordList) -> bool
+{
+    if (not MapFile(fileName, wordList.data, wordList.size))
+    {
+        cerr << "couldn't load " << fileName << endl;
+        return false;
+    }
+    madvise(const_cast<char *>(wordList.data), wordList.size, MADV_SEQUENTIAL);
+    wordList.text = wordList.data;
+
+    // rough guess at the word count so big dictionaries don't keep regrowing the vectors
+    wordList.ownedOffsets.reserve(wordList.size / 8);
+    wordList.ownedEntries.reserve(wordList.size / 8);
+    // almost every word list is plain ASCII, and then a word's width and code point count are just its length
+    bool asciiOnly{AsciiPrefixLength(string_view(wordList.data, wordList.size)) == wordList.size};
+    unsigned int rejected{0};
+    // one pass over the file, memchr finds the line breaks much faster than getline
+    const char *current{wordList.data};
+    const char *end{wordList.data + wordList.size};
+    while (current < end)
+    {
+        auto lineEnd{static_cast<const char *>(memchr(current, '\n', end - current))};
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+        string_view line(current, lineEnd - current);
+        current = lineEnd + 1;
+        // files saved on windows have a \r before each \n
+        if (not line.empty() and line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        // curated lists can give a difficulty after a tab ("word\t2")
+        int difficulty{-1};
+        auto tab{line.find('\t')};
+        if (tab != string_view::npos)
+        {
+            string_view level{line.substr(tab + 1)};
+            if (level.length() == 1 and level[0] >= '0' and level[0] < static_cast<char>('0' + DIFFICULTY_LEVELS))
+            {
+                difficulty = level[0] - '0';
+            }
+            line = line.substr(0, tab);
+        }
+        if (line.empty() or line.length() > UINT16_MAX)
+        {
+            continue;
+        }
+        unsigned int codePoints{static_cast<unsigned int>(line.length())};
+        unsigned int width{codePoints};
+        if (not asciiOnly and not MeasureText(line, codePoints, width))
+        {
+            rejected += 1;
+            continue;
+        }
+        if (width == 0 or width > UINT8_MAX)
+        {
+            continue;
+        }
+        wordList.ownedOffsets.push_back(line.data() - wordList.text);
+        wordList.ownedEntries.push_back({
+            .length = static_cast<uint16_t>(line.length()),
+            .difficulty = static_cast<uint8_t>(difficulty < 0 ? GuessDifficulty(codePoints) : difficulty),
+            .width = static_cast<uint8_t>(width),
+            .codePoints = static_cast<uint16_t>(codePoints),
+            .reserved = 0,
+        });
+    }
+    if (rejected > 0)
+    {
+        cerr << "skipped " << rejected << " lines of " << fileName << " that aren't valid UTF-8" << endl;
+    }
+    BuildDictionaryTables(wordList);
+    wordList.fingerprint = DictionaryFingerprint(wordList);
+    return wordList.wordCount > 0;
+}
+
+// checks that a table of count items of this size starting at start fits inside the file
+auto SectionFits(const dictionary &wordList, uint64_t start, uint64_t count, uint64_t itemSize) -> bool
+{
+    return (start % 4 == 0) and (start + count * itemSize <= wordList.size);
+}
+
+// a hash of the compiled tables, 8 bytes at a time so checking it costs about as much as
+// reading the file (the words themselves were all checked when the text list was compiled)
+auto DictionaryChecksum(const char *bytes, size_t size) -> uint64_t
+{
+    uint64_t hash{14695981039346656037ULL ^ size};
+    size_t position{0};
+    for (; position + sizeof(uint64_t) <= size; position += sizeof(uint64_t))
+    {
+        uint64_t chunk;
+        memcpy(&chunk, bytes + position, sizeof(chunk));
+        hash = (hash ^ chunk) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail{0};
+    memcpy(&tail, bytes + position, size - position);
+    hash = (hash ^ tail) * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+}
+
+// maps a dictionary made by --compile-dictionary, every table is used straight out of the mapping
+// returns false (so the caller can fall back to the text file) if it's missing or doesn't look right.
+// --compile-dictionary only writes tables it built from words it checked, so rather than checking
+// every table against the others again each load, one pass over the file checks it's still
+// byte for byte what was written (a damaged file can't send a lookup outside the mapping)
+auto LoadCompiledWordList(string fileName, dictionary &wordList) -> bool
+{
+    if (not MapFile(fileName, wordList.data, wordList.size))
+    {
+        return false;
+    }
+    dictionaryHeader header;
+    bool valid{wordList.size >= sizeof(header)};
+    if (valid)
+    {
+        memcpy(&header, wordList.data, sizeof(header));
+        valid = (memcmp(header.magic, DICTIONARY_MAGIC, sizeof(header.magic)) == 0) and
+                header.version == DICTIONARY_VERSION and
+                header.difficultyLevels == DIFFICULTY_LEVELS and
+                header.wordCount > 0 and
+                header.maxLength <= UINT16_MAX and
+                SectionFits(wordList, header.offsetsStart, header.wordCount, sizeof(uint32_t)) and
+                SectionFits(wordList, header.entriesStart, header.wordCount, sizeof(dictionaryEntry)) and
+                SectionFits(wordList, header.lengthStartsStart, header.maxLength + 2ULL, sizeof(uint32_t)) and
+                SectionFits(wordList, header.byLengthStart, header.wordCount, sizeof(uint32_t)) and
+                SectionFits(wordList, header.difficultyStartsStart, DIFFICULTY_LEVELS + 1, sizeof(uint32_t)) and
+                SectionFits(wordList, header.byDifficultyStart, header.wordCount, sizeof(uint32_t)) and
+                (static_cast<uint64_t>(header.textStart) + header.textSize <= wordList.size) and
+                DictionaryChecksum(wordList.data + sizeof(header), wordList.size - sizeof(header)) == header.checksum;
+    }
+    if (valid)
+    {
+        // the file is mapped page aligned and every section starts on a multiple of 4
+        wordList.text = wordList.data + header.textStart;
+        wordList.wordCount = header.wordCount;
+        wordList.maxLength = header.maxLength;
+        wordList.offsets = reinterpret_cast<const uint32_t *>(wordList.data + header.offsetsStart);
+        wordList.entries = reinterpret_cast<const dictionaryEntry *>(wordList.data + header.entriesStart);
+        wordList.lengthStarts = reinterpret_cast<const uint32_t *>(wordList.data + header.lengthStartsStart);
+        wordList.byLength = reinterpret_cast<const uint32_t *>(wordList.data + header.byLengthStart);
+        wordList.difficultyStarts = reinterpret_cast<const uint32_t *>(wordList.data + header.difficultyStartsStart);
+        wordList.byDifficulty = reinterpret_cast<const uint32_t *>(wordList.data + header.byDifficultyStart);
+        wordList.fingerprint = header.fingerprint;
+    }
+    if (not valid)
+    {
+        cerr << fileName << " isn't a version " << DICTIONARY_VERSION << " dictionary, ignoring it" << endl;
+        munmap(const_cast<char *>(wordList.data), wordList.size);
+        wordList = dictionary();
+        return false;
+    }
+    return true;
+}
+
+auto UnloadWordList(dictionary &wordList) -> void
+{
+    if (wordList.data != nullptr)
+    {
+        munmap(const_cast<char *>(wordList.data), wordList.size);
+    }
+    wordList = dictionary();
+}
+
+// appends a table to the output, padded so the next one starts on a multiple of 4
+template <typename tableType>
+auto AppendSection(string &output, const tableType *table, size_t count) -> uint32_t
+{
+    uint32_t start{static_cast<uint32_t>(output.size())};
+    output.append(reinterpret_cast<const char *>(table), count * sizeof(tableType));
+    output.append((4 - output.size() % 4) % 4, '\0');
+    return start;
+}
+
+// --compile-dictionary: turns a text word list into the binary format above
+// the new file is written next to the old one and renamed over it, so a game
+// starting at the same time never sees half a dictionary
+auto CompileDictionary(string sourceName, string outputName) -> int
+{
+    dictionary wordList;
+    if (not LoadWordList(sourceName, wordList))
+    {
+        cerr << "no words found in " << sourceName << endl;
+        return EXIT_FAILURE;
+    }
+
+    string packedText;
+    vector<uint32_t> packedOffsets(wordList.wordCount);
+    for (unsigned int number = 0; number < wordList.wordCount; number++)
+    {
+        packedOffsets[number] = packedText.size();
+        packedText += WordAt(wordList, number);
+    }
+
+    dictionaryHeader header{};
+    memcpy(header.magic, DICTIONARY_MAGIC, sizeof(header.magic));
+    header.version = DICTIONARY_VERSION;
+    header.wordCount = wordList.wordCount;
+    header.maxLength = wordList.maxLength;
+    header.difficultyLevels = DIFFICULTY_LEVELS;
+    header.textSize = packedText.size();
+    header.fingerprint = wordList.fingerprint;
+
+    string output(sizeof(header), '\0');
+    header.offsetsStart = AppendSection(output, packedOffsets.data(), wordList.wordCount);
+    header.entriesStart = AppendSection(output, wordList.entries, wordList.wordCount);
+    header.lengthStartsStart = AppendSection(output, wordList.lengthStarts, wordList.maxLength + 2);
+    header.byLengthStart = AppendSection(output, wordList.byLength, wordList.wordCount);
+    header.difficultyStartsStart = AppendSection(output, wordList.difficultyStarts, DIFFICULTY_LEVELS + 1);
+    header.byDifficultyStart = AppendSection(output, wordList.byDifficulty, wordList.wordCount);
+    header.textStart = AppendSection(output, packedText.data(), packedText.size());
+    header.checksum = DictionaryChecksum(output.data() + sizeof(header), output.size() - sizeof(header));
+    memcpy(output.data(), &header, sizeof(header));
+    UnloadWordList(wordList);
+
+    string temporaryName{outputName + ".tmp"};
+    int fileDescriptor{open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if (fileDescriptor < 0)
+    {
+        cerr << "couldn't create " << temporaryName << " [" << errno << "]" << endl;
+        return EXIT_FAILURE;
+    }
+    WriteAll(fileDescriptor, output.data(), output.size());
+    bool written{fsync(fileDescriptor) == 0};
+    close(fileDescriptor);
+    if (not written or rename(temporaryName.c_str(), outputName.c_str()) < 0)
+    {
+        cerr << "couldn't write " << outputName << " [" << errno << "]" << endl;
+        unlink(temporaryName.c_str());
+        return EXIT_FAILURE;
+    }
+    cout << "compiled " << header.wordCount << " words (" << output.size() << " bytes) into " << outputName << endl;
+    return EXIT_SUCCESS;
+}
+
+// High Scores
+// Every finished game is appended to highscores.log (a single write, then fsync),
+// so ending a game never rewrites the whole table and a crash can lose at most the
+// game that was being written. Once the log gets long it is folded into
+// highscores.txt: the new table goes to a temporary file that is renamed over the
+// old one, so the table on disk is always either the old one or the new one.
+// The table keeps the original format (name on one line, score on the next). The log
+// has one "name<tab>score" record per line instead, so a record torn by a crash is one
+// bad line that gets skipped rather than shifting every record after it. Replaying
+// the log twice gives the same result, so a crash between the rename and emptying the
+// log is harmless. Games (and servers) in other processes can share the files: appends
+// hold a shared flock on the log and compaction holds an exclusive one while it reads
+// both files again, writes the table and empties the log, so no append falls in between.
+// Every player's best score is also counted in a Fenwick tree over score buckets, so
+// finding a player's rank takes O(log n) however many players there are. The scores
+// themselves are kept in an order-statistic tree (each node knows how many are below
+// it), so finding who is at a given rank is O(log n) too, even when thousands of
+// players are tied on one score. Both are built up as the files are read.
+
+const unsigned int HIGH_SCORE_TABLE_SIZE{3};  // how many scores the end screen shows
+const unsigned int NEARBY_PLAYERS{2};         // players shown either side of you when you're further down
+const unsigned int COMPACT_AFTER_RECORDS{64}; // log records before they're folded into the table
+const unsigned int SCORE_BUCKET_WIDTH{10};    // points only come in 10s, so a bucket holds one possible score
+const unsigned int MAX_SCORE_BUCKETS{1 << 20}; // anything past 10 million points shares the last bucket
+
+// highest score first, ties in name order
+struct scoreOrder
+{
+    auto operator()(const pair<unsigned int, string> &left, const pair<unsigned int, string> &right) const -> bool
+    {
+        if (left.first != right.first)
+        {
+            return left.first > right.first;
+        }
+        return left.second < right.second;
+    }
+};
+
+// best scores in scoreOrder, any one of them found by its position in O(log n)
+using rankedScores = __gnu_pbds::tree<pair<unsigned int, string>, __gnu_pbds::null_type, scoreOrder,
+                                      __gnu_pbds::rb_tree_tag, __gnu_pbds::tree_order_statistics_node_update>;
+
+// how many players' best scores fall in each bucket, as a Fenwick tree
+struct scoreRanking
+{
+    vector<unsigned int> tree; // node 0 is unused, the rest is a power of two long
+    unsigned int players{0};
+};
+
+struct highScoreStore
+{
+    string tableName;
+    string logName;
+    unordered_map<string, unsigned int> bestByName;           // each player's best score
+    rankedScores byScore;                                      // the same scores, best first
+    scoreRanking ranking;                                      // the same scores again, counted by bucket
+    unsigned int logRecords{0};                                // games appended since the last compaction
+};
+
+auto ScoreBucket(unsigned int score) -> unsigned int
+{
+    return min(score / SCORE_BUCKET_WIDTH, MAX_SCORE_BUCKETS - 1);
+}
+
+// change is +1 when a player's best lands in score's bucket and -1 when it leaves
+auto AddToRanking(scoreRanking &ranking, unsigned int score, int change) -> void
+{
+    for (size_t node = ScoreBucket(score) + 1; node < ranking.tree.size(); node += node & -node)
+    {
+        ranking.tree[node] += change;
+    }
+    ranking.players += change;
+}
+
+// players whose best is in score's bucket or a lower one
+auto CountAtOrBelow(const scoreRanking &ranking, unsigned int score) -> unsigned int
+{
+    unsigned int count{0};
+    for (size_t node = ScoreBucket(score) + 1; node > 0; node -= node & -node)
+    {
+        count += ranking.tree[node];
+    }
+    return count;
+}
+
+// 1 for the best score, players on the same score share a rank
+auto RankOf(const scoreRanking &ranking, unsigned int score) -> unsigned int
+{
+    return ranking.players - CountAtOrBelow(ranking, score) + 1;
+}
+
+// bucket holding the rank'th best score (rank from 1 to players), walking down the tree
+auto BucketAtRank(const scoreRanking &ranking, unsigned int rank) -> unsigned int
+{
+    unsigned int wanted{ranking.players - rank + 1}; // the same score counted from the bottom
+    size_t node{0};
+    // the tree past node 0 is a power of two long, so the first step covers half of it
+    for (size_t step = bit_floor(ranking.tree.size() - 1); step > 0; step /= 2)
+    {
+        if (node + step < ranking.tree.size() and ranking.tree[node + step] < wanted)
+        {
+            node += step;
+            wanted -= ranking.tree[node];
+        }
+    }
+    return node;
+}
+
+// grows the tree (and counts everyone again) when a score is past the last bucket it has
+auto FitRanking(highScoreStore &store, unsigned int score) -> void
+{
+    size_t bucketsNeeded{ScoreBucket(score) + 1};
+    if (bucketsNeeded < store.ranking.tree.size())
+    {
+        return;
+    }
+    store.ranking.tree.assign(bit_ceil(max<size_t>(bucketsNeeded, 256)) + 1, 0);
+    store.ranking.players = 0;
+    for (const auto &[userName, best] : store.bestByName)
+    {
+        AddToRanking(store.ranking, best, 1);
+    }
+}
+
+// where the rank'th best player is in byScore (byScore.end() past the last one)
+auto PlayerAtRank(const highScoreStore &store, unsigned int rank) -> rankedScores::const_iterator
+{
+    if (rank == 0 or rank > store.ranking.players)
+    {
+        return store.byScore.end();
+    }
+    // counts down the tree, so however many players are tied it's never a walk past them
+    return store.byScore.find_by_order(rank - 1);
+}
+
+// keeps a player's best score, returns true if this one beat it
+auto UpdateBestScore(highScoreStore &store, const string &userName, unsigned int score) -> bool
+{
+    FitRanking(store, score);
+    auto best{store.bestByName.find(userName)};
+    if (best != store.bestByName.end())
+    {
+        if (score <= best->second)
+        {
+            return false;
+        }
+        store.byScore.erase({best->second, userName});
+        AddToRanking(store.ranking, best->second, -1);
+        best->second = score;
+    }
+    else
+    {
+        store.bestByName[userName] = score;
+    }
+    store.byScore.insert({score, userName});
+    AddToRanking(store.ranking, score, 1);
+    return true;
+}
+
+// reads the table's name / score line pairs, returns how many complete records there were
+auto ReadScoreTable(const string &fileName, highScoreStore &store) -> unsigned int
+{
+    // init input stream to read from external file
+    ifstream scoreFile(fileName);
+    string userName;
+    string scoreLine;
+    unsigned int records{0};
+    // odd lines have name, even lines have score
+    while (getline(scoreFile, userName) and getline(scoreFile, scoreLine))
+    {
+        unsigned int score{0};
+        auto [end, error]{from_chars(scoreLine.data(), scoreLine.data() + scoreLine.size(), score)};
+        if (error != errc() or userName.empty())
+        {
+            continue;
+        }
+        UpdateBestScore(store, userName, score);
+        records += 1;
+    }
+    return records;
+}
+
+// reads the log's name<tab>score lines, returns how many good records there were
+// a line torn by a crash (or one glued onto the record after it) is just skipped
+auto ReadScoreLog(const string &fileName, highScoreStore &store) -> unsigned int
+{
+    ifstream logFile(fileName);
+    string line;
+    unsigned int records{0};
+    while (getline(logFile, line))
+    {
+        size_t tab{line.find('\t')};
+        if (logFile.eof() or tab == 0 or tab == string::npos)
+        {
+            continue;
+        }
+        unsigned int score{0};
+        auto [end, error]{from_chars(line.data() + tab + 1, line.data() + line.size(), score)};
+        if (error != errc() or end != line.data() + line.size() or tab + 1 == line.size())
+        {
+            continue;
+        }
+        UpdateBestScore(store, line.substr(0, tab), score);
+        records += 1;
+    }
+    return records;
+}
+
+// loads the table and then replays any games logged since it was last written
+auto LoadHighScores(highScoreStore &store, string tableName, string logName) -> void
+{
+    store = highScoreStore();
+    store.tableName = tableName;
+    store.logName = logName;
+    ReadScoreTable(tableName, store);
+    store.logRecords = ReadScoreLog(logName, store);
+}
+
+// writes the whole table to a new file, swaps it in, then empties the log
+// (log is the log file, already locked so nobody can append until it's empty)
+auto WriteScoreTable(highScoreStore &store, int log) -> bool
+{
+    string contents;
+    for (const auto &[score, userName] : store.byScore)
+    {
+        contents += userName + "\n" + to_string(score) + "\n";
+    }
+    string temporaryName{store.tableName + ".tmp"};
+    int fileDescriptor{open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if (fileDescriptor < 0)
+    {
+        cerr << "couldn't create " << temporaryName << " [" << errno << "]" << endl;
+        return false;
+    }
+    WriteAll(fileDescriptor, contents.data(), contents.size());
+    bool written{fsync(fileDescriptor) == 0};
+    close(fileDescriptor);
+    if (not written or rename(temporaryName.c_str(), store.tableName.c_str()) < 0)
+    {
+        cerr << "couldn't replace " << store.tableName << " [" << errno << "]" << endl;
+        unlink(temporaryName.c_str());
+        return false;
+    }
+    // everything in the log is in the table now
+    // (if this fails the log just gets replayed again next time, which changes nothing)
+    if (ftruncate(log, 0) < 0)
+    {
+        cerr << "couldn't empty " << store.logName << " [" << errno << "]" << endl;
+    }
+    store.logRecords = 0;
+    return true;
+}
+
+// folds the log into the table while holding the log's lock
+auto CompactHighScores(highScoreStore &store) -> bool
+{
+    int log{open(store.logName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+    if (log < 0 or flock(log, LOCK_EX) < 0)
+    {
+        cerr << "couldn't lock " << store.logName << " [" << errno << "]" << endl;
+        if (log >= 0)
+        {
+            close(log);
+        }
+        return false;
+    }
+    // other processes may have added to the log or compacted it since we read it,
+    // reading both again only adds what they wrote (best scores can only go up)
+    ReadScoreTable(store.tableName, store);
+    ReadScoreLog(store.logName, store);
+    bool compacted{WriteScoreTable(store, log)};
+    close(log); // drops the lock
+    return compacted;
+}
+
+// adds a finished game to the log (and the table in memory)
+auto RecordScore(highScoreStore &store, const string &userName, unsigned int score) -> void
+{
+    UpdateBestScore(store, userName, score);
+    string record{userName + "\t" + to_string(score) + "\n"};
+    int fileDescriptor{open(store.logName.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)};
+    if (fileDescriptor < 0)
+    {
+        cerr << "couldn't open " << store.logName << " [" << errno << "]" << endl;
+        return;
+    }
+    // one write with O_APPEND, so records from different games never interleave,
+    // under a shared lock so it can't land while another process is compacting
+    flock(fileDescriptor, LOCK_SH);
+    WriteAll(fileDescriptor, record.data(), record.size());
+    fsync(fileDescriptor);
+    close(fileDescriptor);
+    store.logRecords += 1;
+    if (store.logRecords >= COMPACT_AFTER_RECORDS)
+    {
+        CompactHighScores(store);
+    }
+}
+
+// display start menu, allow for user interaction to start/quit game or view rules
+auto StartMenu(string &name) -> bool
+{
+    cout << "*********************" << endl;
+    cout << "WELCOME TO TYPESPEED!" << endl;
+    cout << "*********************" << endl;
+    cout << MakeColour("\ntype \"start\" to start playing, \"rules\" to see rules, or \"quit\" to exit:", COLOUR_CYAN) << endl;
+
+    string command;
+    // get command from user input
+    cin >> command;
+    // loop until user chooses to leave menu or proceed to game
+    while (command.compare("start") != 0 and command.compare("quit") != 0)
+    {
+        if (command.compare("rules") == 0)
+        {
+            cout << "\nHOW IT WORKS:\n* when you start playing, you'll see words moving across the screen: it's your job to type them in!" << endl;
+            cout << "* when you type the word in correctly, you get to clear the word." << endl;
+            cout << "* points will be calculated based on the length of the words you clear." << endl;
+            cout << "* if you don't clear words before they hit the boundary, you'll lose a life. if you lose 5 lives, the game will end." << endl;
+            cout << "\n* once you've typed a character, you can't delete it, so accuracy matters just as much as speed." << endl;
+            cout << "\n* if you want to quit at any point, type \"quit\" in. we won't judge you for it." << endl;
+            cout << "* need a break? type \"pause\", and type it again to carry on." << endl;
+
+            cout << "\nwe hope you enjoy our game! - anna, jessica and tiffany <3" << endl;
+        }
+        else
+        { // input does not match any valid command
+            cout << MakeColour("invalid command, try again ;)", COLOUR_RED) << endl;
+        }
+        cout << MakeColour("\ntype \"start\" to start playing, \"rules\" to see rules, or \"quit\" to exit:", COLOUR_CYAN) << endl;
+        cin >> command;
+    }
+    // user wants to proceed to game
+    if (command.compare("start") == 0)
+    {
+        // get their name to be used in high score list
+        cout << MakeColour("\nbefore we begin, what's your name? it'll be saved for high scores :)", COLOUR_MAGENTA) << endl;
+        cin >> name;
+        return true;
+    }
+    return false;
+}
+
+// displays game over, user score and specific tailored message depending on score
+auto ShowEndScreen(ostream &output, unsigned int score, unsigned int wordsPerMinute, unsigned int accuracy, unsigned int scorelevel = 500) -> void
+{
+    output << " _____ ____  _      _____   ____  _     _____ ____\n"
+           << flush;
+    output << "/  __//  _ \\/ \\__/|/  __/  /  _ \\/ \\ |\\/  __//  __\\\n"
+           << flush;
+    output << "| |  _| / \\|| |\\/|||  \\    | / \\|| | //|  \\  |  \\/|\n"
+           << flush;
+    output << "| |_//| |-||| |  |||  /_   | \\_/|| \\// |  /_ |    /\n"
+           << flush;
+    output << "\\____\\\\_/ \\|\\_/  \\|\\____\\  \\____/\\__/  \\____\\\\_/\\_\\\n\n"
+           << flush;
+    /* scorelevel is default value because if implemented different levels of play (chosen by player at beginning), 
+       scorelevel for a positive message can be adjusted */
+
+    // only display compliment if score over threshold
+    if (score > scorelevel)
+    {
+        output << "you're a pro 😤\n\n"
+               << "score: " << score << "\n"
+               << flush;
+    }
+    else
+    {
+        output << "you tried? 😕\n\n"
+               << "score: " << score << "\n"
+               << flush;
+    }
+    output << "wpm: " << wordsPerMinute << " accuracy: " << accuracy << "%\n"
+           << flush;
+}
+
+// lists count players from the rank'th best down, marking userName's line
+auto ShowRankedPlayers(ostream &output, const highScoreStore &store, unsigned int rank, unsigned int count, const string &userName) -> void
+{
+    auto player{PlayerAtRank(store, rank)};
+    for (unsigned int shown = 0; shown < count and player != store.byScore.end(); shown++, player++)
+    {
+        const auto &[bestScore, bestUser]{*player};
+        output << RankOf(store.ranking, bestScore) << ". " << bestUser << "\t" << bestScore << (bestUser == userName ? "\t<- you" : "") << endl;
+    }
+}
+
+// saves the user's score, then displays where they stand and the top high scores (best first)
+auto ProcessHighScores(ostream &output, highScoreStore &store, string userName, unsigned int score) -> void
+{
+    RecordScore(store, userName, score);
+    unsigned int best{store.bestByName[userName]};
+    unsigned int rank{RankOf(store.ranking, best)};
+    unsigned int players{store.ranking.players};
+    // rounded up, so only the very best player is ever in the top 1%
+    output << "\nyour best: " << best << ", ranked " << rank << " of " << players
+           << " (top " << (rank * 100 + players - 1) / players << "%)" << endl;
+    output << "\nCURRENT HIGH SCORES" << endl;
+    ShowRankedPlayers(output, store, 1, HIGH_SCORE_TABLE_SIZE, userName);
+    if (rank > HIGH_SCORE_TABLE_SIZE)
+    {
+        output << "\nPLAYERS NEAR YOU" << endl;
+        unsigned int firstRank{max(HIGH_SCORE_TABLE_SIZE + 1, rank - min(rank, NEARBY_PLAYERS))};
+        ShowRankedPlayers(output, store, firstRank, rank + NEARBY_PLAYERS + 1 - firstRank, userName);
+    }
+}
+
+// draws the play area box into the back buffer (same shape as the old hard coded border)
+auto DrawBorder(screenBuffer &screen, const playLayout &layout) -> void
+{
+    DrawText(screen, 1, 1, string(layout.fieldWidth - 1, '_'));
+    for (int row = 2; row < layout.fieldHeight; row++)
+    {
+        DrawText(screen, row, 1, "|");
+        DrawText(screen, row, layout.fieldWidth, "|");
+    }
+    DrawText(screen, layout.fieldHeight, 1, string(layout.fieldWidth - 1, '-'));
+}
+
+// Game Modes
+// Classic, sprint, marathon, hardcore and zen only differ in a few rules: what a
+// cleared word is worth, how far words move each step, how often new ones spawn (and
+// which words they are) and what a miss costs. Each rule is a small policy struct, and the phases of a tick are
+// templates over them, so every mode gets its own copy of the per-word loops with its
+// rules compiled in rather than checking the mode for every word. A session picks its
+// mode once when it starts, which points it at that mode's phases.
+
+const unsigned int QUICK_SPAWN_INTERVAL_STEPS{750 / SIMULATION_STEP_MS}; // a new word every 0.75s
+const unsigned int ACCELERATION_STEPS{120000 / SIMULATION_STEP_MS};      // marathon words get another 1x faster every 2 minutes
+const unsigned int MAX_ACCELERATION_STEPS{4 * ACCELERATION_STEPS};       // and stop speeding up at 5x
+const unsigned int SPRINT_STEPS{60000 / SIMULATION_STEP_MS};             // a sprint lasts a minute
+const unsigned int SPRINT_FIRST_LENGTH{3};                               // sprint words start this long
+const unsigned int SPRINT_LAST_LENGTH{10};                               // and get a letter longer every few seconds up to this
+
+// scoring: points for clearing a word, given its length (in code points) and the colour it had got to
+struct lengthScoring
+{ // 10 a letter, the original rule
+    static auto Points(int codePoints, unsigned int) -> unsigned int { return codePoints * 10; }
+};
+
+struct quickScoring
+{ // double for getting to a word while it's still green
+    static auto Points(int codePoints, unsigned int colour) -> unsigned int { return codePoints * (colour == COLOUR_GREEN ? 20 : 10); }
+};
+
+// movement: how far (in 256ths of a column) a word with this speed goes in one step
+// (it has to go up with speed, or a word could catch up with the one in front of it)
+struct steadyMovement
+{
+    static auto Step(int speed, unsigned int) -> int { return speed; }
+};
+
+struct hurriedMovement
+{ // half as fast again
+    static auto Step(int speed, unsigned int) -> int { return speed + speed / 2; }
+};
+
+struct acceleratingMovement
+{ // everything speeds up the longer the game goes on
+    static auto Step(int speed, unsigned int tick) -> int
+    {
+        return speed + static_cast<int>(speed * min(tick, MAX_ACCELERATION_STEPS) / ACCELERATION_STEPS);
+    }
+};
+
+// spawning: whether a new word comes in on this step, and which dictionary word it is
+struct steadySpawning
+{
+    static auto Due(unsigned int tick) -> bool { return tick % SPAWN_INTERVAL_STEPS == 0; }
+    static auto Pick(const dictionary &wordList, unsigned int, default_random_engine &randomEngine) -> unsigned int { return PickWord(wordList, randomEngine); }
+};
+
+struct quickSpawning
+{
+    static auto Due(unsigned int tick) -> bool { return tick % QUICK_SPAWN_INTERVAL_STEPS == 0; }
+    static auto Pick(const dictionary &wordList, unsigned int, default_random_engine &randomEngine) -> unsigned int { return PickWord(wordList, randomEngine); }
+};
+
+struct harderSpawning : steadySpawning
+{ // easy words for the first stretch, then medium ones, then hard ones (as the words speed up)
+    static auto Pick(const dictionary &wordList, unsigned int tick, default_random_engine &randomEngine) -> unsigned int
+    {
+        int number{PickWordOfDifficulty(wordList, min(tick / ACCELERATION_STEPS, DIFFICULTY_LEVELS - 1), randomEngine)};
+        return number >= 0 ? number : PickWord(wordList, randomEngine);
+    }
+};
+
+struct longerSpawning : quickSpawning
+{ // short words to start with, a letter longer every few seconds
+    static auto Pick(const dictionary &wordList, unsigned int tick, default_random_engine &randomEngine) -> unsigned int
+    {
+        unsigned int length{SPRINT_FIRST_LENGTH + min(tick, SPRINT_STEPS) * (SPRINT_LAST_LENGTH - SPRINT_FIRST_LENGTH) / SPRINT_STEPS};
+        int number{PickWordOfLength(wordList, length, randomEngine)};
+        return number >= 0 ? number : PickWord(wordList, randomEngine);
+    }
+};
+
+// lives: how many there are, what a word reaching the boundary costs, and how long the game can last (0 for ever)
+struct fiveLives
+{
+    static constexpr unsigned int STARTING_LIVES{5};
+    static constexpr unsigned int LIVES_PER_MISS{1};
+    static constexpr unsigned int TIME_LIMIT_STEPS{0};
+};
+
+struct tenLives
+{
+    static constexpr unsigned int STARTING_LIVES{10};
+    static constexpr unsigned int LIVES_PER_MISS{1};
+    static constexpr unsigned int TIME_LIMIT_STEPS{0};
+};
+
+struct oneLife
+{
+    static constexpr unsigned int STARTING_LIVES{1};
+    static constexpr unsigned int LIVES_PER_MISS{1};
+    static constexpr unsigned int TIME_LIMIT_STEPS{0};
+};
+
+struct sprintLives
+{
+    static constexpr unsigned int STARTING_LIVES{5};
+    static constexpr unsigned int LIVES_PER_MISS{1};
+    static constexpr unsigned int TIME_LIMIT_STEPS{SPRINT_STEPS};
+};
+
+struct endlessLives
+{ // missed words just go
+    static constexpr unsigned int STARTING_LIVES{5};
+    static constexpr unsigned int LIVES_PER_MISS{0};
+    static constexpr unsigned int TIME_LIMIT_STEPS{0};
+};
+
+template <typename scoringRule, typename movementRule, typename spawnRule, typename lifeRule>
+struct modeRules
+{
+    using scoring = scoringRule;
+    using movement = movementRule;
+    using spawning = spawnRule;
+    using lives = lifeRule;
+};
+
+using classicRules = modeRules<lengthScoring, steadyMovement, steadySpawning, fiveLives>;
+using sprintRules = modeRules<quickScoring, steadyMovement, longerSpawning, sprintLives>;
+using marathonRules = modeRules<lengthScoring, acceleratingMovement, harderSpawning, tenLives>;
+using hardcoreRules = modeRules<lengthScoring, hurriedMovement, quickSpawning, oneLife>;
+using zenRules = modeRules<lengthScoring, steadyMovement, steadySpawning, endlessLives>;
+
+struct gameSession;
+
+// a mode picked at run time: its name, its limits and the phases compiled for its rules
+struct gameMode
+{
+    const char *name;
+    unsigned int startingLives;
+    unsigned int timeLimitSteps;
+    auto (*spawn)(gameSession &session, const dictionary &wordList) -> void;
+    auto (*move)(gameSession &session) -> void;
+    auto (*clear)(gameSession &session) -> void;
+};
+
+// Game Sessions
+// Everything one game needs lives in a gameSession, so the local game and every
+// game hosted by the server run the same code on their own state. The dictionary
+// is the only thing shared between sessions, and it is never written to.
+// Nothing in here touches the terminal: a session is driven from code by feeding it
+// keystrokes and calling RunSessionTick, and with the same seed and the same input
+// it always plays out the same way (that's what --benchmark relies on).
+
+struct gameSession
+{
+    wordStore activeWords;
+    wordlookup index;
+    prefixMatcher matcher;
+    laneAllocator lanes;
+    unsigned int ticks{0};
+    unsigned int score{0};
+    unsigned int lives{5};
+    bool quit{false};
+    bool paused{false};
+    const gameMode *mode{nullptr}; // set by StartSession
+    string currentCommand;
+    inputRing input;
+    screenBuffer screen;
+    playLayout layout;
+    default_random_engine randomEngine;
+    bool dirty{true}; // something on screen changed since the last frame was drawn
+    chrono::steady_clock::time_point lastFrame;
+    typingStats stats;
+    parallelTick parallel; // only used once there are PARALLEL_TICK_WORDS words and a pool to share them with
+};
+
+// the terminal changed size mid game: lay everything out again, with each word the same
+// fraction of the way across (and down) the new field as it was on the old one
+auto ResizeSession(gameSession &session, int rows, int cols) -> void
+{
+    playLayout oldLayout{session.layout};
+    session.layout = ComputeLayout(rows, cols);
+    ResizeScreen(session.screen, rows, cols);
+    wordStore &words{session.activeWords};
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        words.row[i] = clamp(2 + (words.row[i] - 2) * (session.layout.fieldHeight - 2) / (oldLayout.fieldHeight - 2), 2, session.layout.fieldHeight - 1);
+        // stop short of the boundary, a resize shouldn't cost a life
+        words.col[i] = clamp(words.col[i] * session.layout.fieldWidth / oldLayout.fieldWidth, 2, max(2, session.layout.fieldWidth - words.width[i] - 1));
+        words.position[i] = words.col[i] << SUBCELL_BITS;
+    }
+    RebuildLanes(session.lanes, words, session.layout);
+    session.dirty = true;
+}
+
+// the game has really ended: out of lives or (in a sprint) out of time
+auto SessionFinished(const gameSession &session) -> bool
+{
+    return session.lives == 0 or (session.mode->timeLimitSteps != 0 and session.ticks >= session.mode->timeLimitSteps);
+}
+
+// game is over once the user typed "quit" or it has finished
+auto SessionOver(const gameSession &session) -> bool
+{
+    return session.quit or SessionFinished(session);
+}
+
+// queues keystrokes as if they'd just been typed, returns how many fit in the input ring
+auto FeedSessionInput(gameSession &session, string_view keys) -> size_t
+{
+    return PushInput(session.input, keys.data(), keys.length(), MicrosecondsNow());
+}
+
+// handles every keystroke that has arrived, not just one per tick
+auto ConsumeSessionInput(gameSession &session) -> void
+{
+    TRACE_SCOPE("input");
+    if (session.input.tail.load(memory_order_relaxed) != session.input.head.load(memory_order_acquire))
+    {
+        session.dirty = true; // every keystroke shows up somewhere
+    }
+    ConsumeInput(session.input, session.activeWords, session.index, session.matcher, session.currentCommand, session.quit, session.paused, session.stats);
+}
+
+auto SessionWordsPerMinute(const gameSession &session) -> unsigned int
+{
+    return WordsPerMinute(session.stats.lettersCleared, session.ticks);
+}
+
+// adds a finished game into the totals printed at exit
+auto FinishSessionStats(const gameSession &session) -> void
+{
+    lock_guard<mutex> guard(processTypingLock);
+    MergeTypingStats(processTypingStats, session.stats, session.ticks);
+}
+
+// The three phases of a tick, in the order RunSessionTick runs them
+// (kept separate so the benchmark can time each one, and compiled once for each mode)
+
+template <typename rules>
+auto SpawnPhase(gameSession &session, const dictionary &wordList) -> void
+{
+    TRACE_SCOPE("spawn");
+    session.ticks += 1;
+    if (rules::spawning::Due(session.ticks))
+    { // only create words every so often to space them out
+        session.dirty = true;
+        CreateWord(session.activeWords, session.index, session.matcher, session.lanes, wordList, session.randomEngine, session.ticks,
+                   [&wordList, &session](default_random_engine &randomEngine)
+                   { return rules::spawning::Pick(wordList, session.ticks, randomEngine); });
+    }
+}
+
+template <typename rules>
+auto MovePhase(gameSession &session) -> void
+{
+    TRACE_SCOPE("move");
+    bool changed{UseParallelTick(session.parallel, session.activeWords)
+                     ? UpdateWordColumnPositionsParallel<typename rules::movement>(session.activeWords, session.lanes, session.layout, session.ticks, session.parallel)
+                     : UpdateWordColumnPositions<typename rules::movement>(session.activeWords, session.lanes, session.layout, session.ticks)};
+    if (changed)
+    {
+        session.dirty = true;
+    }
+}
+
+template <typename rules>
+auto ClearPhase(gameSession &session) -> void
+{
+    TRACE_SCOPE("clear");
+    // clear any activeWords that were matched/are past boundary
+    unsigned int countBefore{session.activeWords.count};
+    if (UseParallelTick(session.parallel, session.activeWords))
+    {
+        ClearWordsParallel<typename rules::scoring, typename rules::lives>(session.activeWords, session.index, session.matcher, session.lanes, session.layout, session.score, session.lives, session.stats, session.ticks, session.parallel);
+    }
+    else
+    {
+        ClearWords<typename rules::scoring, typename rules::lives>(session.activeWords, session.index, session.matcher, session.lanes, session.layout, session.score, session.lives, session.stats, session.ticks);
+    }
+    if (session.activeWords.count != countBefore)
+    {
+        session.dirty = true;
+    }
+}
+
+// moves the game on by one simulation step
+// (nothing moves while the game is paused)
+auto RunSessionTick(gameSession &session, const dictionary &wordList) -> void
+{
+    if (session.paused)
+    {
+        return;
+    }
+    session.mode->spawn(session, wordList);
+    session.mode->move(session);
+    session.mode->clear(session);
+}
+
+template <typename rules>
+constexpr auto MakeGameMode(const char *name) -> gameMode
+{
+    return {name, rules::lives::STARTING_LIVES, rules::lives::TIME_LIMIT_STEPS, SpawnPhase<rules>, MovePhase<rules>, ClearPhase<rules>};
+}
+
+// recordings and snapshots store a mode as its place in here, so new ones go on the end
+const unsigned int MODE_CLASSIC{0};
+const array<gameMode, 5> GAME_MODES{{MakeGameMode<classicRules>("classic"),
+                                     MakeGameMode<sprintRules>("sprint"),
+                                     MakeGameMode<marathonRules>("marathon"),
+                                     MakeGameMode<hardcoreRules>("hardcore"),
+                                     MakeGameMode<zenRules>("zen")}};
+
+// nullptr if there's no mode with that name
+auto FindGameMode(string_view name) -> const gameMode *
+{
+    for (const auto &mode : GAME_MODES)
+    {
+        if (name == mode.name)
+        {
+            return &mode;
+        }
+    }
+    return nullptr;
+}
+
+auto ModeNumberOf(const gameMode &mode) -> unsigned int
+{
+    return static_cast<unsigned int>(&mode - GAME_MODES.data());
+}
+
+auto StartSession(gameSession &session, int rows, int cols, unsigned int wordCapacity, unsigned int sessionSeed, const gameMode &mode = GAME_MODES[MODE_CLASSIC]) -> void
+{
+    InitWordStore(session.activeWords, wordCapacity);
+    session.index.clear();
+    ResetMatcher(session.matcher);
+    for (auto &bucket : session.matcher.byFirstByte)
+    {
+        bucket.clear();
+    }
+    session.ticks = 0;
+    session.score = 0;
+    session.lives = mode.startingLives;
+    session.quit = false;
+    session.paused = false;
+    session.mode = &mode;
+    session.currentCommand.clear();
+    ResizeScreen(session.screen, rows, cols);
+    session.layout = ComputeLayout(rows, cols);
+    ResetLanes(session.lanes, session.layout);
+    session.randomEngine.seed(sessionSeed);
+    session.dirty = true;
+    session.stats = typingStats();
+}
+
+
+// a frame is only drawn when something on screen changed, and no more often than frameInterval
+auto FrameDue(const gameSession &session, chrono::steady_clock::time_point now, chrono::nanoseconds frameInterval) -> bool
+{
+    return session.dirty and now - session.lastFrame >= frameInterval;
+}
+
+// redraws everything on the game screen, the changes end up in session.screen.output
+auto DrawGameFrame(gameSession &session) -> void
+{
+    TRACE_SCOPE("draw");
+    session.dirty = false;
+    session.lastFrame = chrono::steady_clock::now();
+    screenBuffer &screen{session.screen};
+    ClearBackBuffer(screen);
+    DrawBorder(screen, session.layout);
+    DisplayWords(screen, session.activeWords, session.matcher);
+    // shows stats at bottom of terminal
+    ShowStats(screen, session.layout.statsRow, session.score, session.lives, SessionWordsPerMinute(session), AccuracyPercent(session.stats));
+    // command displayed just above stats
+    if (session.paused)
+    {
+        string_view notice{"PAUSED - type pause to carry on"};
+        DrawText(screen, session.layout.fieldHeight / 2, (session.layout.fieldWidth - static_cast<int>(notice.length())) / 2, notice, COLOUR_CYAN);
+    }
+    string commandLine{"Command: " + session.currentCommand};
+    int commandEnd{DrawText(screen, session.layout.commandRow, 1, commandLine)};
+    EncodeFrame(screen, session.layout.commandRow, min(screen.cols, commandEnd));
+}
+
+// Snapshots
+// A snapshot is everything a session needs to carry on exactly where it was: the
+// score, lives, what's been typed, where every word is and the state of the random
+// number generator. It's taken between ticks on the game's own thread (a few hundred
+// bytes, written in microseconds), and restoring one rebuilds the lookups from the
+// words, so a session can be saved and picked up again later or in another process.
+// Numbers are varints (7 bits to a byte, signed ones zigzagged first), and words are
+// stored as their number in the dictionary, so a snapshot only works with the word
+// list it was taken with (it records a fingerprint to check).
+
+const char SNAPSHOT_MAGIC[4]{'T', 'S', 'P', 'S'};
+const uint64_t SNAPSHOT_VERSION{2}; // 2 added the game mode
+const unsigned int SNAPSHOT_INTERVAL_STEPS{5000 / SIMULATION_STEP_MS}; // the local game saves one every 5s
+const string DEFAULT_SNAPSHOT{"lastgame.tss"};
+
+auto AppendVarint(string &output, uint64_t value) -> void
+{
+    while (value >= 0x80)
+    {
+        output += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    output += static_cast<char>(value);
+}
+
+// reads a varint off the front of data, false if it runs off the end
+auto ReadVarint(string_view &data, uint64_t &value) -> bool
+{
+    value = 0;
+    for (unsigned int shift = 0; shift < 64 and not data.empty(); shift += 7)
+    {
+        uint8_t byte{static_cast<uint8_t>(data.front())};
+        data.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// small negative numbers (words sliding in from the left) stay small
+auto AppendSigned(string &output, int64_t value) -> void
+{
+    AppendVarint(output, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+auto ReadSigned(string_view &data, int64_t &value) -> bool
+{
+    uint64_t zigzag{0};
+    bool read{ReadVarint(data, zigzag)};
+    value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+    return read;
+}
+
+auto AppendBytes(string &output, string_view bytes) -> void
+{
+    AppendVarint(output, bytes.size());
+    output += bytes;
+}
+
+auto ReadBytes(string_view &data, string_view &bytes) -> bool
+{
+    uint64_t length{0};
+    if (not ReadVarint(data, length) or length > data.size())
+    {
+        return false;
+    }
+    bytes = data.substr(0, length);
+    data.remove_prefix(length);
+    return true;
+}
+
+// replaces output with a snapshot of the session (output keeps its memory between snapshots)
+auto SaveSnapshot(const gameSession &session, const dictionary &wordList, string &output) -> void
+{
+    TRACE_SCOPE("snapshot");
+    output.assign(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    for (uint64_t value : {SNAPSHOT_VERSION, static_cast<uint64_t>(wordList.wordCount), wordList.fingerprint,
+                           static_cast<uint64_t>(session.screen.rows), static_cast<uint64_t>(session.screen.cols),
+                           static_cast<uint64_t>(session.ticks), static_cast<uint64_t>(session.score), static_cast<uint64_t>(session.lives),
+                           static_cast<uint64_t>(session.quit), static_cast<uint64_t>(session.paused), static_cast<uint64_t>(ModeNumberOf(*session.mode))})
+    {
+        AppendVarint(output, value);
+    }
+    AppendBytes(output, session.currentCommand);
+    // the standard only promises the engine can be written and read back as text
+    ostringstream engineState;
+    engineState << session.randomEngine;
+    AppendBytes(output, engineState.str());
+
+    const wordStore &words{session.activeWords};
+    AppendVarint(output, words.count);
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        AppendVarint(output, WordNumberOf(wordList, words.content[i]));
+        AppendVarint(output, words.row[i]);
+        AppendSigned(output, words.col[i]);
+        AppendSigned(output, words.position[i]);
+        AppendSigned(output, words.speed[i]);
+        AppendVarint(output, words.colour[i]);
+        AppendVarint(output, words.cleared[i]);
+        AppendVarint(output, words.bornTick[i]);
+    }
+}
+
+// puts the session back the way the snapshot had it, false (and the session left
+// freshly started) if the snapshot is damaged or from another word list
+auto RestoreSnapshot(gameSession &session, const dictionary &wordList, string_view data, unsigned int wordCapacity) -> bool
+{
+    TRACE_SCOPE("restore");
+    if (not data.starts_with(string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))))
+    {
+        return false;
+    }
+    data.remove_prefix(sizeof(SNAPSHOT_MAGIC));
+    array<uint64_t, 11> header{};
+    for (auto &value : header)
+    {
+        if (not ReadVarint(data, value))
+        {
+            return false;
+        }
+    }
+    auto [version, wordCount, fingerprint, rows, cols, ticks, score, lives, quit, paused, mode]{header};
+    if (version != SNAPSHOT_VERSION or wordCount != wordList.wordCount or fingerprint != wordList.fingerprint or
+        rows < BORDER_HEIGHT + ROWS_BELOW_FIELD or cols < BORDER_WIDTH or rows > UINT16_MAX or cols > UINT16_MAX or mode >= GAME_MODES.size() or
+        ticks > UINT_MAX or score > UINT_MAX or lives > GAME_MODES[mode].startingLives or quit > 1 or paused > 1)
+    {
+        return false;
+    }
+    StartSession(session, rows, cols, wordCapacity, 0, GAME_MODES[mode]);
+    session.ticks = ticks;
+    session.score = score;
+    session.lives = lives;
+    session.quit = quit;
+    session.paused = paused;
+    string_view command;
+    string_view engineState;
+    uint64_t count{0};
+    if (not ReadBytes(data, command) or not ReadBytes(data, engineState) or not ReadVarint(data, count) or count > wordCapacity)
+    {
+        return false;
+    }
+    session.currentCommand = command;
+    istringstream engineText{string(engineState)};
+    engineText >> session.randomEngine;
+
+    wordStore &words{session.activeWords};
+    for (uint64_t i = 0; i < count; i++)
+    {
+        array<uint64_t, 5> fields{};
+        array<int64_t, 3> signedFields{};
+        auto &[number, row, colour, cleared, bornTick]{fields};
+        auto &[col, position, speed]{signedFields};
+        bool read{ReadVarint(data, number) and ReadVarint(data, row) and ReadSigned(data, col) and ReadSigned(data, position) and
+                  ReadSigned(data, speed) and ReadVarint(data, colour) and ReadVarint(data, cleared) and ReadVarint(data, bornTick)};
+        // anything a move couldn't have left behind means the file is damaged: a word has to be
+        // inside the play area at the column its position gives, with a speed and colour words can have
+        bool inRange{read and number < wordList.wordCount and row >= 2 and row < static_cast<uint64_t>(session.layout.fieldHeight) and
+                     speed > 0 and speed <= BASE_WORD_SPEED * 5 / 4 and position >= 0 and position <= INT_MAX and
+                     (colour == COLOUR_GREEN or colour == COLOUR_YELLOW or colour == COLOUR_RED) and cleared <= 1 and bornTick <= ticks};
+        if (inRange)
+        {
+            int lastCol{session.layout.fieldWidth - wordList.entries[number].width};
+            inRange = col >= 2 and col == min<int64_t>(lastCol, position >> SUBCELL_BITS);
+        }
+        if (not inRange)
+        {
+            StartSession(session, rows, cols, wordCapacity, 0, GAME_MODES[mode]);
+            return false;
+        }
+        string_view content{WordAt(wordList, number)};
+        AddWord(words, content, wordList.entries[number], row, col, speed, colour, bornTick);
+        words.position[i] = position;
+        words.cleared[i] = cleared;
+        session.index[content].push_back(i);
+        AddFirstByteWord(session.matcher, content, i);
+    }
+    // the lanes and the typed prefix only depend on the words, so they're worked out again
+    RebuildLanes(session.lanes, words, session.layout);
+    if (not session.paused and not session.currentCommand.empty())
+    {
+        session.matcher.prefix = session.currentCommand;
+        for (unsigned int i = 0; i < words.count; i++)
+        {
+            if (not words.cleared[i] and words.content[i].starts_with(session.matcher.prefix))
+            {
+                session.matcher.candidates.push_back(i);
+            }
+        }
+    }
+    return true;
+}
+
+// swaps a new snapshot in on disk (written next to the old one and renamed over it)
+auto WriteSnapshotFile(const string &fileName, const string &snapshot) -> bool
+{
+    string temporaryName{fileName + ".tmp"};
+    int fileDescriptor{open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if (fileDescriptor < 0)
+    {
+        cerr << "couldn't create " << temporaryName << " [" << errno << "]" << endl;
+        return false;
+    }
+    WriteAll(fileDescriptor, snapshot.data(), snapshot.size());
+    // on disk before the rename, or a crash could leave an empty save where the last good one was
+    bool written{fsync(fileDescriptor) == 0};
+    close(fileDescriptor);
+    if (not written or rename(temporaryName.c_str(), fileName.c_str()) < 0)
+    {
+        cerr << "couldn't replace " << fileName << " [" << errno << "]" << endl;
+        unlink(temporaryName.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Recording and Replay
+// Every local game is recorded to lastgame.tsr (or wherever TYPESPEED_RECORD points,
+// set it to nothing to turn recording off): the seed, the starting terminal size and
+// which word list was used, then every chunk of keystrokes read from the terminal and
+// every resize, each tagged with the number of ticks run since the one before. Nothing
+// else feeds into a game, so --replay can play it out again exactly and check that the
+// score and lives come out the same. Numbers are written as varints (7 bits to a byte),
+// so a single keystroke usually costs 3 bytes.
+// The game loop only appends to a buffer; full buffers are handed to a thread of their
+// own to write, so the disk never holds up a tick.
+
+const char RECORDING_MAGIC[4]{'T', 'S', 'P', 'R'};
+const uint64_t RECORDING_VERSION{2}; // 2 added the game mode
+const size_t RECORDING_FLUSH_BYTES{4096}; // buffer size that gets handed to the writer
+const string DEFAULT_RECORDING{"lastgame.tsr"};
+
+// what follows a record's tick count (kept in its low RECORD_KIND_BITS)
+const unsigned int RECORD_KIND_BITS{2};
+const uint64_t RECORD_KEYS{0};   // length, then the chars
+const uint64_t RECORD_RESIZE{1}; // rows, cols
+const uint64_t RECORD_END{2};    // final score, lives
+
+struct sessionRecorder
+{
+    int fileDescriptor{-1}; // -1 when not recording
+    string buffer;          // only touched by the game loop
+    uint64_t pendingTicks{0}; // ticks run since the last record
+    mutex lock;
+    condition_variable wakeUp;
+    deque<string> full; // buffers waiting to be written
+    bool stopping{false};
+    thread writer;
+};
+
+// the only thread that writes to the recording
+auto RunRecordingWriter(sessionRecorder &recorder) -> void
+{
+    unique_lock<mutex> guard(recorder.lock);
+    while (true)
+    {
+        recorder.wakeUp.wait(guard, [&recorder]
+                             { return recorder.stopping or not recorder.full.empty(); });
+        if (recorder.full.empty())
+        {
+            return; // stopping, and everything has been written
+        }
+        string chunk{move(recorder.full.front())};
+        recorder.full.pop_front();
+        guard.unlock();
+
+        TRACE_SCOPE("write recording");
+        WriteAll(recorder.fileDescriptor, chunk.data(), chunk.size());
+
+        guard.lock();
+    }
+}
+
+// hands the buffer to the writer thread
+auto FlushRecording(sessionRecorder &recorder) -> void
+{
+    {
+        lock_guard<mutex> guard(recorder.lock);
+        recorder.full.push_back(move(recorder.buffer));
+    }
+    recorder.wakeUp.notify_one();
+    recorder.buffer = string();
+    recorder.buffer.reserve(RECORDING_FLUSH_BYTES * 2);
+}
+
+auto StartRecording(sessionRecorder &recorder, const string &fileName, unsigned int sessionSeed, const gameMode &mode, int rows, int cols, const dictionary &wordList) -> bool
+{
+    recorder.fileDescriptor = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (recorder.fileDescriptor < 0)
+    {
+        cerr << "couldn't create " << fileName << " [" << errno << "]" << endl;
+        return false;
+    }
+    recorder.buffer.reserve(RECORDING_FLUSH_BYTES * 2);
+    recorder.buffer.append(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    for (uint64_t value : {RECORDING_VERSION, static_cast<uint64_t>(sessionSeed), static_cast<uint64_t>(rows), static_cast<uint64_t>(cols),
+                           static_cast<uint64_t>(wordList.wordCount), wordList.fingerprint, static_cast<uint64_t>(ModeNumberOf(mode))})
+    {
+        AppendVarint(recorder.buffer, value);
+    }
+    recorder.pendingTicks = 0;
+    recorder.stopping = false;
+    recorder.writer = thread(RunRecordingWriter, ref(recorder));
+    return true;
+}
+
+// every record starts with the ticks run since the last one and what kind of record it is
+auto BeginRecord(sessionRecorder &recorder, uint64_t kind) -> void
+{
+    AppendVarint(recorder.buffer, recorder.pendingTicks << RECORD_KIND_BITS | kind);
+    recorder.pendingTicks = 0;
+}
+
+auto EndRecord(sessionRecorder &recorder) -> void
+{
+    if (recorder.buffer.size() >= RECORDING_FLUSH_BYTES)
+    {
+        FlushRecording(recorder);
+    }
+}
+
+auto RecordTick(sessionRecorder &recorder) -> void
+{
+    recorder.pendingTicks += 1;
+}
+
+// records whatever has been pushed into the ring since its head was at headBefore
+auto RecordInput(sessionRecorder &recorder, const inputRing &ring, size_t headBefore) -> void
+{
+    size_t head{ring.head.load(memory_order_relaxed)};
+    if (recorder.fileDescriptor < 0 or head == headBefore)
+    {
+        return;
+    }
+    BeginRecord(recorder, RECORD_KEYS);
+    AppendVarint(recorder.buffer, head - headBefore);
+    for (size_t position = headBefore; position != head; position++)
+    {
+        recorder.buffer += ring.buffer[position & (INPUT_RING_CAPACITY - 1)];
+    }
+    EndRecord(recorder);
+}
+
+auto RecordResize(sessionRecorder &recorder, int rows, int cols) -> void
+{
+    if (recorder.fileDescriptor < 0)
+    {
+        return;
+    }
+    BeginRecord(recorder, RECORD_RESIZE);
+    AppendVarint(recorder.buffer, rows);
+    AppendVarint(recorder.buffer, cols);
+    EndRecord(recorder);
+}
+
+// writes the result the replay has to match, then waits for everything to hit the disk
+auto StopRecording(sessionRecorder &recorder, unsigned int score, unsigned int lives) -> void
+{
+    if (recorder.fileDescriptor < 0)
+    {
+        return;
+    }
+    BeginRecord(recorder, RECORD_END);
+    AppendVarint(recorder.buffer, score);
+    AppendVarint(recorder.buffer, lives);
+    FlushRecording(recorder);
+    {
+        lock_guard<mutex> guard(recorder.lock);
+        recorder.stopping = true;
+    }
+    recorder.wakeUp.notify_one();
+    recorder.writer.join();
+    fsync(recorder.fileDescriptor);
+    close(recorder.fileDescriptor);
+    recorder.fileDescriptor = -1;
+}
+
+// --replay <file> [realtime|snapshots]
+// plays a recording back through the game with nothing drawn, as fast as it will go
+// (or at the speed it was played with realtime), and fails if the result differs.
+// With snapshots the game is saved and carried on in a brand new session every few
+// seconds of play, which should make no difference at all to how it ends.
+auto RunReplay(const string &fileName, bool realTime, bool viaSnapshots) -> int
+{
+    const char *fileData{nullptr};
+    size_t fileSize{0};
+    if (not MapFile(fileName, fileData, fileSize))
+    {
+        cerr << "couldn't read " << fileName << endl;
+        return EXIT_FAILURE;
+    }
+    string_view data(fileData, fileSize);
+    array<uint64_t, 7> header{};
+    bool headerRead{data.starts_with(string_view(RECORDING_MAGIC, sizeof(RECORDING_MAGIC)))};
+    data.remove_prefix(min(data.size(), sizeof(RECORDING_MAGIC)));
+    for (auto &value : header)
+    {
+        headerRead = headerRead and ReadVarint(data, value);
+    }
+    auto [version, sessionSeed, rows, cols, wordCount, fingerprint, mode]{header};
+    if (not headerRead or version != RECORDING_VERSION or mode >= GAME_MODES.size())
+    {
+        cerr << fileName << " isn't a recording this version can play" << endl;
+        munmap(const_cast<char *>(fileData), fileSize);
+        return EXIT_FAILURE;
+    }
+
+    dictionary wordList;
+    if (not LoadCompiledWordList("wordlist.tsd", wordList) and not LoadWordList("wordlist.txt", wordList))
+    {
+        cerr << "couldn't load any words from wordlist.txt" << endl;
+        munmap(const_cast<char *>(fileData), fileSize);
+        return EXIT_FAILURE;
+    }
+    if (wordList.wordCount != wordCount or wordList.fingerprint != fingerprint)
+    {
+        cerr << fileName << " was recorded with a different word list" << endl;
+        UnloadWordList(wordList);
+        munmap(const_cast<char *>(fileData), fileSize);
+        return EXIT_FAILURE;
+    }
+
+    auto session{make_unique<gameSession>()};
+    StartSession(*session, rows, cols, WORD_STORE_CAPACITY, sessionSeed, GAME_MODES[mode]);
+    unsigned long long keysReplayed{0};
+    bool ended{false};
+    bool matched{false};
+    uint64_t recordedScore{0};
+    uint64_t recordedLives{0};
+    string snapshot;
+    unsigned long long snapshotCount{0};
+    unsigned long long snapshotBytes{0};
+    chrono::duration<double, micro> saveTime{0};
+    chrono::duration<double, micro> restoreTime{0};
+    auto startTime{chrono::steady_clock::now()};
+    uint64_t tag{0};
+    while (not ended and ReadVarint(data, tag))
+    {
+        for (uint64_t step = 0; step < tag >> RECORD_KIND_BITS; step++)
+        {
+            if (realTime)
+            {
+                this_thread::sleep_until(startTime + chrono::milliseconds(SIMULATION_STEP_MS) * session->ticks);
+            }
+            RunSessionTick(*session, wordList);
+            if (viaSnapshots and session->ticks % SNAPSHOT_INTERVAL_STEPS == 0)
+            {
+                auto saveStart{chrono::steady_clock::now()};
+                SaveSnapshot(*session, wordList, snapshot);
+                auto restoreStart{chrono::steady_clock::now()};
+                auto restored{make_unique<gameSession>()};
+                if (not RestoreSnapshot(*restored, wordList, snapshot, WORD_STORE_CAPACITY))
+                {
+                    cout << "couldn't restore the snapshot taken at tick " << session->ticks << endl;
+                    break;
+                }
+                saveTime += restoreStart - saveStart;
+                restoreTime += chrono::steady_clock::now() - restoreStart;
+                snapshotBytes += snapshot.size();
+                snapshotCount += 1;
+                // typing stats aren't part of a snapshot
+                restored->stats = move(session->stats);
+                session = move(restored);
+            }
+        }
+        uint64_t kind{tag & ((1 << RECORD_KIND_BITS) - 1)};
+        uint64_t first{0};
+        uint64_t second{0};
+        if (kind == RECORD_KEYS and ReadVarint(data, first) and first <= data.size())
+        {
+            string_view keys{data.substr(0, first)};
+            data.remove_prefix(first);
+            keysReplayed += keys.size();
+            while (not keys.empty())
+            { // the game read these in one go, and always had room for them
+                keys.remove_prefix(FeedSessionInput(*session, keys));
+                ConsumeSessionInput(*session);
+            }
+        }
+        else if (kind == RECORD_RESIZE and ReadVarint(data, first) and ReadVarint(data, second))
+        {
+            ResizeSession(*session, first, second);
+        }
+        else if (kind == RECORD_END and ReadVarint(data, recordedScore) and ReadVarint(data, recordedLives))
+        {
+            ended = true;
+            matched = recordedScore == session->score and recordedLives == session->lives;
+        }
+        else
+        {
+            break;
+        }
+    }
+    chrono::duration<double> elapsed{chrono::steady_clock::now() - startTime};
+
+    cout << "mode: " << session->mode->name << " ticks: " << session->ticks << " keystrokes: " << keysReplayed << " in " << elapsed.count() << "s ("
+         << static_cast<unsigned long long>(session->ticks / elapsed.count()) << " ticks/sec)" << endl;
+    cout << "score: " << session->score << " lives: " << session->lives << endl;
+    if (snapshotCount > 0)
+    {
+        cout << "snapshots: " << snapshotCount << " average " << snapshotBytes / snapshotCount << " bytes, save "
+             << saveTime.count() / snapshotCount << "us restore " << restoreTime.count() / snapshotCount << "us" << endl;
+    }
+    if (not ended)
+    {
+        cout << "the recording stops before the end of the game (did it crash?)" << endl;
+    }
+    else if (not matched)
+    {
+        cout << "MISMATCH: the recorded game ended with score: " << recordedScore << " lives: " << recordedLives << endl;
+    }
+    FinishSessionStats(*session);
+    PrintTypingStats(cerr, processTypingStats);
+    UnloadWordList(wordList);
+    munmap(const_cast<char *>(fileData), fileSize);
+    return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Server Mode
+// --server hosts many games in one process. Each connection (Unix socket or TCP, so
+// plain nc or a pty works as a client) gets its own gameSession, and they all share
+// the one dictionary. The main thread only does I/O: it accepts connections, reads
+// keystrokes into each session's input ring and counts ticks off a single timerfd.
+// The game logic runs on a small pool of worker threads. Every worker has its own
+// queue and steals from the back of the others when it runs out. A session is only
+// ever run by one worker at a time: pendingEvents counts what has happened to it since
+// it was last run, and whoever bumps it from 0 is the one that queues it.
+// Nothing ever waits on a client socket. Output is sent straight away if the socket
+// takes it, and whatever it doesn't take waits in the session's outbox while the I/O
+// thread watches the socket for EPOLLOUT and sends the rest as it drains.
+// High scores all go through one writer thread, so the log is never written twice at once.
+
+const unsigned int SESSION_ROWS{BORDER_HEIGHT + ROWS_BELOW_FIELD}; // same layout as the 35 x 70 local minimum
+const unsigned int SESSION_COLS{BORDER_WIDTH};
+const unsigned int SESSION_WORD_CAPACITY{256}; // a session only ever has a handful of words on screen
+const unsigned int MAX_NAME_LENGTH{32};
+const size_t MAX_PENDING_OUTPUT{256 * 1024}; // a client this far behind on its output gets dropped
+const int SEND_TIMEOUT_MS{2000}; // how long a finished client gets to take the rest of its output
+
+struct serverSession
+{
+    int socketFd{-1};
+    gameSession game;
+    string userName;
+    bool greeted{false}; // the rest of these are only touched by whichever worker runs the session
+    bool named{false};
+    bool ended{false};
+    atomic<bool> hungUp{false};             // set by the I/O thread when the client goes away
+    atomic<unsigned int> stepsDue{0};       // simulation steps since the session last ran
+    atomic<unsigned int> pendingEvents{0};  // non zero while the session is queued or running
+    atomic<bool> finished{false};           // set once the score is saved, the session can be closed
+    mutex outputLock;                       // the outbox is filled by workers and drained by the I/O thread
+    string outbox;                          // output the socket hasn't taken yet
+    bool watchingWrites{false};             // EPOLLOUT is on while the outbox has anything in it
+    unsigned int finishedTicks{0};          // ticks since finishing, only counted by the I/O thread
+};
+
+struct workQueue
+{
+    mutex lock;
+    deque<serverSession *> tasks;
+};
+
+struct scoreWriter
+{
+    highScoreStore store;
+    mutex lock;
+    condition_variable wakeUp;
+    deque<serverSession *> pending;
+    bool stopping{false};
+    thread worker;
+};
+
+struct sessionServer
+{
+    const dictionary *wordList{nullptr};
+    int listenFd{-1};
+    int epollFd{-1};
+    tickScheduler scheduler;
+    unordered_map<int, unique_ptr<serverSession>> sessions; // by socket, only touched by the I/O thread
+    vector<unique_ptr<workQueue>> queues;                    // one per worker
+    vector<thread> workers;
+    atomic<size_t> nextQueue{0};
+    atomic<long> queued{0}; // sessions sitting in any queue
+    mutex sleepLock;
+    condition_variable wakeUp;
+    atomic<bool> stopping{false};
+    scoreWriter scores;
+};
+
+atomic<bool> serverInterrupted{false};
+
+auto InterruptServer(int) -> void
+{
+    serverInterrupted = true;
+}
+
+// sends as much as the socket takes without waiting, returns how much that was (or -1 if it's gone)
+auto SendWithoutWaiting(int socketFd, const char *data, size_t length) -> long
+{
+    size_t total{0};
+    while (total < length)
+    {
+        auto sent{send(socketFd, data + total, length - total, MSG_NOSIGNAL | MSG_DONTWAIT)};
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                break;
+            }
+            return -1;
+        }
+        total += sent;
+    }
+    return static_cast<long>(total);
+}
+
+// EPOLLOUT on while there's output waiting, off once it's gone (outputLock is held)
+// (fails harmlessly once the I/O thread has stopped watching a client that hung up)
+auto WatchWrites(sessionServer &server, serverSession &session, bool watching) -> void
+{
+    if (session.watchingWrites == watching)
+    {
+        return;
+    }
+    session.watchingWrites = watching;
+    struct epoll_event event{};
+    event.events = watching ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.fd = session.socketFd;
+    epoll_ctl(server.epollFd, EPOLL_CTL_MOD, session.socketFd, &event);
+}
+
+// sends text after anything already waiting, returns false if the client has gone or is too far behind
+auto SendText(sessionServer &server, serverSession &session, string_view text) -> bool
+{
+    lock_guard<mutex> guard(session.outputLock);
+    if (session.outbox.empty())
+    {
+        long sent{SendWithoutWaiting(session.socketFd, text.data(), text.size())};
+        if (sent < 0)
+        {
+            return false;
+        }
+        text.remove_prefix(sent);
+    }
+    if (text.empty())
+    {
+        return true;
+    }
+    if (session.outbox.size() + text.size() > MAX_PENDING_OUTPUT)
+    {
+        return false;
+    }
+    session.outbox += text;
+    WatchWrites(server, session, true);
+    return true;
+}
+
+// the socket has room again: sends what's waiting (only called by the I/O thread)
+auto FlushOutput(sessionServer &server, serverSession &session) -> bool
+{
+    lock_guard<mutex> guard(session.outputLock);
+    long sent{SendWithoutWaiting(session.socketFd, session.outbox.data(), session.outbox.size())};
+    if (sent < 0)
+    {
+        session.outbox.clear();
+        return false;
+    }
+    session.outbox.erase(0, sent);
+    WatchWrites(server, session, not session.outbox.empty());
+    return true;
+}
+
+auto OutputDrained(serverSession &session) -> bool
+{
+    lock_guard<mutex> guard(session.outputLock);
+    return session.outbox.empty();
+}
+
+// hands the session to a worker, round robin (idle workers steal anything left waiting)
+auto QueueSession(sessionServer &server, serverSession &session) -> void
+{
+    auto &queue{*server.queues[server.nextQueue.fetch_add(1, memory_order_relaxed) % server.queues.size()]};
+    {
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(&session);
+    }
+    server.queued.fetch_add(1);
+    {
+        // taking the lock means a worker can't miss this between checking and sleeping
+        lock_guard<mutex> guard(server.sleepLock);
+    }
+    server.wakeUp.notify_one();
+}
+
+// records that something happened to the session, queues it unless it's already queued / running
+auto NotifySession(sessionServer &server, serverSession &session) -> void
+{
+    if (session.pendingEvents.fetch_add(1) == 0)
+    {
+        QueueSession(server, session);
+    }
+}
+
+// own queue from the front, everybody else's from the back
+auto TakeSession(sessionServer &server, size_t workerNumber) -> serverSession *
+{
+    size_t queueCount{server.queues.size()};
+    for (size_t offset = 0; offset < queueCount; offset++)
+    {
+        auto &queue{*server.queues[(workerNumber + offset) % queueCount]};
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+        serverSession *session;
+        if (offset == 0)
+        {
+            session = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        else
+        {
+            session = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        server.queued.fetch_sub(1);
+        return session;
+    }
+    return nullptr;
+}
+
+auto SubmitScore(scoreWriter &scores, serverSession &session) -> void
+{
+    {
+        lock_guard<mutex> guard(scores.lock);
+        scores.pending.push_back(&session);
+    }
+    scores.wakeUp.notify_one();
+}
+
+// the only thread that touches the high score files while the server is running
+auto RunScoreWriter(sessionServer &server) -> void
+{
+    scoreWriter &scores{server.scores};
+    unique_lock<mutex> guard(scores.lock);
+    while (true)
+    {
+        scores.wakeUp.wait(guard, [&scores]
+                           { return scores.stopping or not scores.pending.empty(); });
+        if (scores.pending.empty())
+        {
+            return; // stopping, and everything has been saved
+        }
+        serverSession *session{scores.pending.front()};
+        scores.pending.pop_front();
+        guard.unlock();
+
+        TRACE_SCOPE("save score");
+        ostringstream table;
+        ProcessHighScores(table, scores.store, session->userName, session->game.score);
+        table << endl;
+        if (not session->hungUp)
+        {
+            SendText(server, *session, table.str());
+        }
+        session->finished = true;
+
+        guard.lock();
+    }
+}
+
+// the game is over: show the end screen and pass the score to the writer
+auto EndServerSession(sessionServer &server, serverSession &session) -> void
+{
+    session.ended = true;
+    if (not session.named)
+    { // never got as far as playing
+        session.finished = true;
+        return;
+    }
+    ostringstream endScreen;
+    endScreen << STOP_COLOUR << ANSI_START << "2J" << ANSI_START << "1;1H" << ANSI_START << "?25h";
+    ShowEndScreen(endScreen, session.game.score, SessionWordsPerMinute(session.game), AccuracyPercent(session.game.stats));
+    FinishSessionStats(session.game);
+    if (not session.hungUp and not SendText(server, session, endScreen.str()))
+    {
+        session.hungUp = true;
+    }
+    SubmitScore(server.scores, session);
+}
+
+// everything the session has to do since it last ran: name entry, keystrokes, a tick, a frame
+auto ServiceSession(sessionServer &server, serverSession &session) -> void
+{
+    TRACE_SCOPE("session");
+    if (session.ended)
+    {
+        return;
+    }
+    gameSession &game{session.game};
+    if (not session.greeted)
+    {
+        session.greeted = true;
+        if (not SendText(server, session, "WELCOME TO TYPESPEED!\r\nwhat's your name? it'll be saved for high scores :)\r\n"))
+        {
+            session.hungUp = true;
+        }
+    }
+    // a worker that fell behind catches up, but only so far (like the local game)
+    unsigned int stepsDue{min(session.stepsDue.exchange(0), MAX_CATCH_UP_STEPS)};
+    if (not session.named)
+    {
+        char currentChar;
+        int64_t arrivedUs;
+        while (not session.named and PopInput(game.input, currentChar, arrivedUs))
+        {
+            if (currentChar == '\n' and not session.userName.empty())
+            {
+                session.named = true;
+            }
+            else if (isprint(static_cast<unsigned char>(currentChar)) and session.userName.length() < MAX_NAME_LENGTH)
+            {
+                session.userName += currentChar;
+            }
+        }
+        stepsDue = 0;
+    }
+    if (session.named and not session.hungUp)
+    {
+        ConsumeSessionInput(game);
+        for (unsigned int step = 0; step < stepsDue and not SessionOver(game); step++)
+        {
+            RunSessionTick(game, *server.wordList);
+        }
+        // a frame goes out at most once per step, and only when something changed
+        if (not SessionOver(game) and game.dirty)
+        {
+            DrawGameFrame(game);
+            if (not game.screen.output.empty() and not SendText(server, session, game.screen.output))
+            {
+                session.hungUp = true;
+            }
+        }
+    }
+    if (session.hungUp or SessionOver(game))
+    {
+        EndServerSession(server, session);
+    }
+}
+
+auto RunWorker(sessionServer &server, size_t workerNumber) -> void
+{
+    while (true)
+    {
+        serverSession *session{TakeSession(server, workerNumber)};
+        if (session == nullptr)
+        {
+            unique_lock<mutex> guard(server.sleepLock);
+            server.wakeUp.wait(guard, [&server]
+                               { return server.stopping or server.queued > 0; });
+            if (server.stopping and server.queued == 0)
+            {
+                return;
+            }
+            continue;
+        }
+        // keep going until nothing new happened while we were running it
+        unsigned int handled{session->pendingEvents.load()};
+        while (true)
+        {
+            ServiceSession(server, *session);
+            // after this the session may be closed by the I/O thread, don't touch it again
+            unsigned int remaining{session->pendingEvents.fetch_sub(handled) - handled};
+            if (remaining == 0)
+            {
+                break;
+            }
+            handled = remaining;
+        }
+    }
+}
+
+// "1234" is a TCP port on every interface, anything else is the path of a Unix socket
+auto OpenListener(const string &address) -> int
+{
+    bool isPort{not address.empty() and all_of(address.begin(), address.end(), ::isdigit)};
+    int listenFd{socket(isPort ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)};
+    if (listenFd < 0)
+    {
+        cerr << "socket failed [" << errno << "]" << endl;
+        return -1;
+    }
+    int bound{-1};
+    if (isPort)
+    {
+        int reuse{1};
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        uint16_t port{0};
+        if (not ParseNumber(address, port))
+        {
+            cerr << "not a port number: " << address << endl;
+            close(listenFd);
+            return -1;
+        }
+        local.sin_port = htons(port);
+        bound = bind(listenFd, reinterpret_cast<struct sockaddr *>(&local), sizeof(local));
+    }
+    else
+    {
+        struct sockaddr_un local{};
+        local.sun_family = AF_UNIX;
+        if (address.length() >= sizeof(local.sun_path))
+        {
+            cerr << "socket path too long: " << address << endl;
+            close(listenFd);
+            return -1;
+        }
+        memcpy(local.sun_path, address.c_str(), address.length() + 1);
+        unlink(address.c_str()); // left behind by a server that didn't shut down cleanly
+        bound = bind(listenFd, reinterpret_cast<struct sockaddr *>(&local), sizeof(local));
+    }
+    if (bound < 0 or listen(listenFd, SOMAXCONN) < 0)
+    {
+        cerr << "couldn't listen on " << address << " [" << errno << "]" << endl;
+        close(listenFd);
+        return -1;
+    }
+    return listenFd;
+}
+
+auto AcceptClients(sessionServer &server) -> void
+{
+    while (true)
+    {
+        int clientFd{accept4(server.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)};
+        if (clientFd < 0)
+        {
+            if (errno != EAGAIN and errno != EINTR)
+            {
+                cerr << "accept failed [" << errno << "]" << endl;
+            }
+            return;
+        }
+        int noDelay{1};
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // fails harmlessly on Unix sockets
+        auto session{make_unique<serverSession>()};
+        session->socketFd = clientFd;
+        StartSession(session->game, SESSION_ROWS, SESSION_COLS, SESSION_WORD_CAPACITY, randDevice());
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = clientFd;
+        if (epoll_ctl(server.epollFd, EPOLL_CTL_ADD, clientFd, &event) < 0)
+        {
+            cerr << "epoll_ctl failed [" << errno << "]" << endl;
+            close(clientFd);
+            continue;
+        }
+        serverSession &added{*session};
+        server.sessions[clientFd] = move(session);
+        NotifySession(server, added); // sends the greeting
+    }
+}
+
+// moves whatever the client sent into its input ring (the I/O thread is the ring's only producer)
+auto ReadClient(sessionServer &server, serverSession &session) -> void
+{
+    char chunk[INPUT_RING_CAPACITY];
+    auto bytesRead{read(session.socketFd, chunk, sizeof(chunk))};
+    if (bytesRead < 0 and (errno == EAGAIN or errno == EINTR))
+    {
+        return;
+    }
+    if (bytesRead <= 0)
+    {
+        // stop watching it, the worker ends the game and the socket is closed once the score is saved
+        epoll_ctl(server.epollFd, EPOLL_CTL_DEL, session.socketFd, nullptr);
+        session.hungUp = true;
+    }
+    else
+    {
+        // a client typing faster than the game can keep up with just loses the excess
+        PushInput(session.game.input, chunk, bytesRead, MicrosecondsNow());
+    }
+    NotifySession(server, session);
+}
+
+// closes every session whose score has been saved, that no worker is holding and whose
+// output has all gone (or that has had SEND_TIMEOUT_MS to take it)
+auto ReapSessions(sessionServer &server, uint64_t ticks) -> void
+{
+    for (auto current = server.sessions.begin(); current != server.sessions.end();)
+    {
+        serverSession &session{*current->second};
+        if (session.finished)
+        {
+            session.finishedTicks += ticks;
+        }
+        if (session.finished and session.pendingEvents == 0 and
+            (session.hungUp or session.finishedTicks * SIMULATION_STEP_MS >= SEND_TIMEOUT_MS or OutputDrained(session)))
+        {
+            epoll_ctl(server.epollFd, EPOLL_CTL_DEL, session.socketFd, nullptr);
+            close(session.socketFd);
+            current = server.sessions.erase(current);
+        }
+        else
+        {
+            ++current;
+        }
+    }
+}
+
+// --server <port or socket path> [worker threads]
+auto RunServer(const string &address, unsigned int workerCount) -> int
+{
+    dictionary wordList;
+    if (not LoadCompiledWordList("wordlist.tsd", wordList) and not LoadWordList("wordlist.txt", wordList))
+    {
+        cerr << "couldn't load any words from wordlist.txt" << endl;
+        return EXIT_FAILURE;
+    }
+    sessionServer server;
+    server.wordList = &wordList;
+    server.listenFd = OpenListener(address);
+    server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (server.listenFd < 0 or server.epollFd < 0 or not StartTickScheduler(server.scheduler, SIMULATION_STEP_MS))
+    {
+        return EXIT_FAILURE;
+    }
+    for (int watchedFd : {server.listenFd, server.scheduler.timerFd})
+    {
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = watchedFd;
+        epoll_ctl(server.epollFd, EPOLL_CTL_ADD, watchedFd, &event);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, InterruptServer);
+    signal(SIGTERM, InterruptServer);
+
+    LoadHighScores(server.scores.store, "highscores.txt", "highscores.log");
+    server.scores.worker = thread(RunScoreWriter, ref(server));
+    workerCount = max(workerCount, 1U);
+    for (unsigned int number = 0; number < workerCount; number++)
+    {
+        server.queues.push_back(make_unique<workQueue>());
+    }
+    for (unsigned int number = 0; number < workerCount; number++)
+    {
+        server.workers.emplace_back(RunWorker, ref(server), number);
+    }
+    cerr << "serving on " << address << " with " << workerCount << " workers" << endl;
+
+    const int MAX_EVENTS{256};
+    struct epoll_event events[MAX_EVENTS];
+    while (not serverInterrupted)
+    {
+        int ready{epoll_wait(server.epollFd, events, MAX_EVENTS, -1)};
+        CheckTraceDumpRequest();
+        if (ready < 0)
+        {
+            if (errno != EINTR)
+            {
+                cerr << "epoll_wait failed [" << errno << "]" << endl;
+                break;
+            }
+            continue;
+        }
+        for (int number = 0; number < ready; number++)
+        {
+            int readyFd{events[number].data.fd};
+            if (readyFd == server.listenFd)
+            {
+                AcceptClients(server);
+            }
+            else if (readyFd == server.scheduler.timerFd)
+            {
+                uint64_t timerCount{0};
+                if (read(server.scheduler.timerFd, &timerCount, sizeof(timerCount)) == sizeof(timerCount))
+                {
+                    ReapSessions(server, timerCount);
+                    for (auto &[socketFd, session] : server.sessions)
+                    {
+                        if (not session->finished)
+                        {
+                            session->stepsDue.fetch_add(static_cast<unsigned int>(timerCount));
+                            NotifySession(server, *session);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                auto session{server.sessions.find(readyFd)};
+                if (session == server.sessions.end())
+                {
+                    continue;
+                }
+                if ((events[number].events & EPOLLOUT) and not FlushOutput(server, *session->second))
+                { // the client went away, the worker ends the game
+                    epoll_ctl(server.epollFd, EPOLL_CTL_DEL, readyFd, nullptr);
+                    session->second->hungUp = true;
+                    NotifySession(server, *session->second);
+                    continue;
+                }
+                if (events[number].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    ReadClient(server, *session->second);
+                }
+            }
+        }
+    }
+
+    // let the workers finish what's queued, then save the scores that are still waiting
+    cerr << "shutting down, " << server.sessions.size() << " sessions open" << endl;
+    {
+        lock_guard<mutex> guard(server.sleepLock);
+        server.stopping = true;
+    }
+    server.wakeUp.notify_all();
+    for (auto &worker : server.workers)
+    {
+        worker.join();
+    }
+    {
+        lock_guard<mutex> guard(server.scores.lock);
+        server.scores.stopping = true;
+    }
+    server.scores.wakeUp.notify_all();
+    server.scores.worker.join();
+    PrintTypingStats(cerr, processTypingStats);
+    for (auto &[socketFd, session] : server.sessions)
+    {
+        FlushOutput(server, *session); // one last try, without waiting
+        close(socketFd);
+    }
+    server.sessions.clear();
+    StopTickScheduler(server.scheduler);
+    close(server.epollFd);
+    close(server.listenFd);
+    if (not all_of(address.begin(), address.end(), ::isdigit))
+    {
+        unlink(address.c_str());
+    }
+    UnloadWordList(wordList);
+    return EXIT_SUCCESS;
+}
+
+// Spectating
+// With TYPESPEED_BROADCAST set to a socket path (or a port number), anyone can watch
+// the local game with nc -U <path>. Each frame is encoded once, for the player's own
+// terminal, and that one immutable buffer is queued for every viewer, so more viewers
+// only means more sends. The sending is done by a thread of its own with nonblocking
+// scatter/gather sends (several queued frames go out in one call), never by the game loop.
+// A viewer starts from a keyframe, a full repaint the game only encodes when someone
+// is waiting for one (straight away, even while the game is paused and nothing else is
+// drawn). A viewer that falls too far behind has its backlog thrown away and skips ahead
+// to the next keyframe, and one that leaves queued frames untaken for too long is dropped.
+
+const size_t MAX_VIEWER_BACKLOG{64};   // frames queued for a viewer before it skips ahead
+const int VIEWER_TIMEOUT_MS{5000};      // a viewer that takes nothing for this long is dropped
+const size_t FRAMES_PER_SEND{16};       // most queued frames handed to a single sendmsg()
+
+using sharedFrame = shared_ptr<const string>;
+
+// what the game loop hands over for each frame
+struct spectatorFrame
+{
+    sharedFrame changes;  // the same bytes the player's terminal got
+    sharedFrame keyframe; // the whole screen, only there if someone asked for one
+};
+
+struct viewer
+{
+    int socketFd{-1};
+    deque<sharedFrame> backlog;
+    size_t sentOfFirst{0};       // how much of backlog.front() has gone already
+    bool waitingForKeyframe{true};
+    chrono::steady_clock::time_point lastProgress;
+};
+
+struct broadcaster
+{
+    string address;
+    int listenFd{-1};
+    int wakeFd{-1};                   // eventfd, poked whenever frames are handed over
+    mutex lock;
+    deque<spectatorFrame> published;  // handed over by the game loop, taken by the sender
+    bool stopping{false};
+    atomic<bool> keyframeWanted{false};
+    atomic<size_t> viewerCount{0};
+    screenBuffer keyframeScreen;      // only used by the game loop, to encode keyframes
+    thread sender;
+    // everything below is only touched by the sender thread
+    vector<viewer> viewers;
+    unsigned long long viewersServed{0};
+    unsigned long long viewersDropped{0};
+    unsigned long long skippedAhead{0};
+};
+
+// the whole of the last drawn screen, for viewers starting (or starting again) from scratch
+auto EncodeKeyframe(broadcaster &spectators, const screenBuffer &screen) -> sharedFrame
+{
+    screenBuffer &keyframe{spectators.keyframeScreen};
+    if (keyframe.rows != screen.rows or keyframe.cols != screen.cols)
+    {
+        ResizeScreen(keyframe, screen.rows, screen.cols);
+    }
+    keyframe.back = screen.back;
+    keyframe.repaintAll = true;
+    EncodeFrame(keyframe, screen.cursorRow, screen.cursorCol);
+    return make_shared<const string>(keyframe.output);
+}
+
+// queues the frame for the sender and wakes it
+auto HandOver(broadcaster &spectators, spectatorFrame frame) -> void
+{
+    {
+        lock_guard<mutex> guard(spectators.lock);
+        spectators.published.push_back(move(frame));
+    }
+    uint64_t one{1};
+    if (write(spectators.wakeFd, &one, sizeof(one)) < 0 and errno != EAGAIN)
+    {
+        cerr << "couldn't wake the spectator thread [" << errno << "]" << endl;
+    }
+}
+
+// game loop side: hands the frame that's just been drawn to the sender
+auto PublishFrame(broadcaster &spectators, const screenBuffer &screen) -> void
+{
+    if (spectators.viewerCount.load(memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    TRACE_SCOPE("publish");
+    spectatorFrame frame{make_shared<const string>(screen.output), nullptr};
+    if (spectators.keyframeWanted.exchange(false))
+    {
+        frame.keyframe = EncodeKeyframe(spectators, screen);
+    }
+    HandOver(spectators, move(frame));
+}
+
+// game loop side: while nothing is being drawn (paused, or waiting on the player) a viewer
+// that has just joined would see nothing until the next frame, so it gets a keyframe anyway
+auto PublishKeyframe(broadcaster &spectators, const screenBuffer &screen) -> void
+{
+    if (spectators.viewerCount.load(memory_order_relaxed) == 0 or not spectators.keyframeWanted.exchange(false))
+    {
+        return;
+    }
+    TRACE_SCOPE("publish");
+    HandOver(spectators, {nullptr, EncodeKeyframe(spectators, screen)});
+}
+
+auto AcceptViewers(broadcaster &spectators) -> void
+{
+    while (true)
+    {
+        int viewerFd{accept4(spectators.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)};
+        if (viewerFd < 0)
+        {
+            if (errno != EAGAIN and errno != EINTR)
+            {
+                cerr << "accept failed [" << errno << "]" << endl;
+            }
+            return;
+        }
+        int noDelay{1};
+        setsockopt(viewerFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // fails harmlessly on Unix sockets
+        spectators.viewers.push_back({viewerFd, {}, 0, true, chrono::steady_clock::now()});
+        spectators.viewersServed += 1;
+        spectators.keyframeWanted = true;
+    }
+}
+
+// queues a frame for every viewer that can use it
+auto QueueFrame(broadcaster &spectators, const spectatorFrame &frame) -> void
+{
+    for (auto &watcher : spectators.viewers)
+    {
+        if (watcher.waitingForKeyframe)
+        {
+            // a keyframe only makes sense once the last frame has gone out whole
+            if (frame.keyframe and watcher.sentOfFirst == 0)
+            {
+                watcher.backlog.clear();
+                watcher.backlog.push_back(frame.keyframe);
+                watcher.waitingForKeyframe = false;
+            }
+            continue;
+        }
+        if (not frame.changes)
+        {
+            continue; // a keyframe on its own, nothing changed for viewers who are keeping up
+        }
+        watcher.backlog.push_back(frame.changes);
+        if (watcher.backlog.size() > MAX_VIEWER_BACKLOG)
+        {
+            // too far behind: finish the frame that's half sent, drop the rest, start again from a keyframe
+            watcher.backlog.resize(watcher.sentOfFirst > 0 ? 1 : 0);
+            watcher.waitingForKeyframe = true;
+            spectators.skippedAhead += 1;
+        }
+    }
+}
+
+// sends as much of the backlog as the socket will take, false if the viewer has gone
+auto SendBacklog(viewer &watcher) -> bool
+{
+    while (not watcher.backlog.empty())
+    {
+        array<struct iovec, FRAMES_PER_SEND> pieces;
+        size_t pieceCount{min(watcher.backlog.size(), FRAMES_PER_SEND)};
+        for (size_t piece = 0; piece < pieceCount; piece++)
+        {
+            const string &frame{*watcher.backlog[piece]};
+            size_t skip{piece == 0 ? watcher.sentOfFirst : 0};
+            pieces[piece].iov_base = const_cast<char *>(frame.data() + skip);
+            pieces[piece].iov_len = frame.size() - skip;
+        }
+        struct msghdr message{};
+        message.msg_iov = pieces.data();
+        message.msg_iovlen = pieceCount;
+        auto sent{sendmsg(watcher.socketFd, &message, MSG_NOSIGNAL | MSG_DONTWAIT)};
+        if (sent < 0)
+        {
+            return errno == EAGAIN or errno == EINTR;
+        }
+        watcher.lastProgress = chrono::steady_clock::now();
+        size_t left{static_cast<size_t>(sent)};
+        while (left > 0 and left >= watcher.backlog.front()->size() - watcher.sentOfFirst)
+        {
+            left -= watcher.backlog.front()->size() - watcher.sentOfFirst;
+            watcher.backlog.pop_front();
+            watcher.sentOfFirst = 0;
+        }
+        watcher.sentOfFirst += left;
+        if (left > 0)
+        {
+            return true; // the socket is full
+        }
+    }
+    return true;
+}
+
+// viewers have nothing to say, but reading tells us when they've gone
+auto ViewerHungUp(viewer &watcher) -> bool
+{
+    char ignored[256];
+    auto bytesRead{read(watcher.socketFd, ignored, sizeof(ignored))};
+    return bytesRead == 0 or (bytesRead < 0 and errno != EAGAIN and errno != EINTR);
+}
+
+// the sender thread: accepts viewers and keeps them fed, so the game loop never waits on a socket
+auto RunBroadcaster(broadcaster &spectators) -> void
+{
+    vector<struct pollfd> watched;
+    deque<spectatorFrame> arrived;
+    while (true)
+    {
+        watched.clear();
+        watched.push_back({spectators.listenFd, POLLIN, 0});
+        watched.push_back({spectators.wakeFd, POLLIN, 0});
+        for (const auto &watcher : spectators.viewers)
+        {
+            watched.push_back({watcher.socketFd, static_cast<short>(POLLIN | (watcher.backlog.empty() ? 0 : POLLOUT)), 0});
+        }
+        if (poll(watched.data(), watched.size(), VIEWER_TIMEOUT_MS / 4) < 0 and errno != EINTR)
+        {
+            cerr << "spectator poll failed [" << errno << "]" << endl;
+            return;
+        }
+
+        if (watched[1].revents & POLLIN)
+        {
+            uint64_t pokes;
+            if (read(spectators.wakeFd, &pokes, sizeof(pokes)) < 0 and errno != EAGAIN)
+            {
+                cerr << "couldn't read the spectator eventfd [" << errno << "]" << endl;
+            }
+        }
+        {
+            lock_guard<mutex> guard(spectators.lock);
+            if (spectators.stopping)
+            {
+                return;
+            }
+            arrived.swap(spectators.published);
+        }
+        for (const auto &frame : arrived)
+        {
+            QueueFrame(spectators, frame);
+        }
+        arrived.clear();
+
+        auto now{chrono::steady_clock::now()};
+        size_t kept{0};
+        for (size_t number = 0; number < spectators.viewers.size(); number++)
+        {
+            viewer &watcher{spectators.viewers[number]};
+            short events{number + 2 < watched.size() ? watched[number + 2].revents : static_cast<short>(0)};
+            bool gone{(events & (POLLERR | POLLHUP)) or ((events & POLLIN) and ViewerHungUp(watcher)) or not SendBacklog(watcher)};
+            // only frames queued and not taken count: waiting on a keyframe is waiting on the game
+            bool behind{not watcher.backlog.empty()};
+            bool stuck{behind and now - watcher.lastProgress > chrono::milliseconds(VIEWER_TIMEOUT_MS)};
+            if (gone or stuck)
+            {
+                close(watcher.socketFd);
+                spectators.viewersDropped += stuck;
+                continue;
+            }
+            if (not behind)
+            {
+                watcher.lastProgress = now; // nothing owed, so it isn't falling behind
+            }
+            if (watcher.waitingForKeyframe)
+            {
+                spectators.keyframeWanted = true;
+            }
+            if (kept != number)
+            {
+                spectators.viewers[kept] = move(watcher);
+            }
+            kept += 1;
+        }
+        spectators.viewers.resize(kept);
+
+        if (watched[0].revents & POLLIN)
+        {
+            AcceptViewers(spectators);
+        }
+        spectators.viewerCount = spectators.viewers.size();
+    }
+}
+
+auto StartBroadcast(broadcaster &spectators, const string &address) -> bool
+{
+    spectators.address = address;
+    spectators.listenFd = OpenListener(address);
+    if (spectators.listenFd < 0)
+    {
+        return false;
+    }
+    spectators.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (spectators.wakeFd < 0)
+    {
+        cerr << "eventfd failed [" << errno << "]" << endl;
+        close(spectators.listenFd);
+        spectators.listenFd = -1;
+        return false;
+    }
+    spectators.sender = thread(RunBroadcaster, ref(spectators));
+    return true;
+}
+
+auto StopBroadcast(broadcaster &spectators) -> void
+{
+    if (spectators.listenFd < 0)
+    {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(spectators.lock);
+        spectators.stopping = true;
+    }
+    uint64_t one{1};
+    if (write(spectators.wakeFd, &one, sizeof(one)) < 0)
+    {
+        cerr << "couldn't wake the spectator thread [" << errno << "]" << endl;
+    }
+    spectators.sender.join();
+    for (const auto &watcher : spectators.viewers)
+    {
+        close(watcher.socketFd);
+    }
+    cerr << "spectators: " << spectators.viewersServed << " watched, " << spectators.skippedAhead << " skipped ahead, "
+         << spectators.viewersDropped << " dropped for not keeping up" << endl;
+    close(spectators.wakeFd);
+    close(spectators.listenFd);
+    if (not all_of(spectators.address.begin(), spectators.address.end(), ::isdigit))
+    {
+        unlink(spectators.address.c_str());
+    }
+    spectators.listenFd = -1;
+}
+
+// Benchmarks
+// --benchmark runs sessions headless with scripted typists and reports how fast the
+// engine goes. Everything is seeded, so two runs with the same arguments play exactly
+// the same games (the checksum at the end has to match), and only the timings move.
+
+// Counting allocations means replacing operator new for the whole program (the game
+// and the server too), so it's only compiled in with -DTYPESPEED_COUNT_ALLOCATIONS.
+#ifdef TYPESPEED_COUNT_ALLOCATIONS
+const bool COUNTING_ALLOCATIONS{true};
+
+// every operator new in the program bumps this, so the benchmark can report allocations per tick
+atomic<unsigned long long> allocationCount{0};
+
+auto operator new(size_t size) -> void *
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    void *allocated{malloc(size == 0 ? 1 : size)};
+    if (allocated == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return allocated;
+}
+
+// new[] and delete[] go through these two as well
+// (not inlined, or gcc sees free() on memory from new and warns about a mismatch that isn't one)
+[[gnu::noinline]] auto operator delete(void *allocated) noexcept -> void
+{
+    free(allocated);
+}
+
+[[gnu::noinline]] auto operator delete(void *allocated, size_t) noexcept -> void
+{
+    free(allocated);
+}
+
+auto AllocationsSoFar() -> unsigned long long
+{
+    return allocationCount.load(memory_order_relaxed);
+}
+#else
+const bool COUNTING_ALLOCATIONS{false};
+
+auto AllocationsSoFar() -> unsigned long long
+{
+    return 0;
+}
+#endif
+
+// types at a fixed rate and makes the odd mistake, always going for the word closest to the edge
+struct scriptedTypist
+{
+    double keysPerTick;   // 0.125 is roughly 60 words per minute at 25ms simulation steps
+    double accuracy;      // chance each key is the right one
+    default_random_engine randomEngine;
+    double keyCredit{0};  // keys owed from the fractional rate
+    string target{};      // word being typed, empty when looking for one
+    size_t typed{0};
+    string keys{};        // what to feed the session this tick (kept so it doesn't reallocate)
+};
+
+// decides what the typist presses during this tick
+auto ScriptTypist(scriptedTypist &typist, const gameSession &session) -> string_view
+{
+    typist.keys.clear();
+    typist.keyCredit += typist.keysPerTick;
+    uniform_real_distribution<double> chance(0.0, 1.0);
+    uniform_int_distribution<int> wrongKey('a', 'z');
+    const wordStore &words{session.activeWords};
+    if (not typist.target.empty() and session.index.find(string_view(typist.target)) == session.index.end())
+    {
+        // the word hit the edge before we finished it, start again
+        typist.keys += '\n';
+        typist.target.clear();
+    }
+    while (typist.keyCredit >= 1.0)
+    {
+        typist.keyCredit -= 1.0;
+        if (typist.target.empty())
+        {
+            int best{-1};
+            for (unsigned int i = 0; i < words.count; i++)
+            {
+                if (not words.cleared[i] and (best < 0 or words.col[i] + words.width[i] > words.col[best] + words.width[best]))
+                {
+                    best = static_cast<int>(i);
+                }
+            }
+            if (best < 0)
+            {
+                continue; // nothing on screen, the key is wasted
+            }
+            typist.target.assign(words.content[best]);
+            typist.typed = 0;
+        }
+        if (chance(typist.randomEngine) < typist.accuracy)
+        {
+            typist.keys += typist.target[typist.typed];
+            typist.typed += 1;
+            if (typist.typed == typist.target.length())
+            { // completing the word clears it without enter, unless a longer word on screen starts the same way
+                for (unsigned int i = 0; i < words.count; i++)
+                {
+                    if (words.length[i] > static_cast<int>(typist.typed) and words.content[i].starts_with(typist.target))
+                    {
+                        typist.keys += '\n';
+                        break;
+                    }
+                }
+                typist.target.clear();
+            }
+        }
+        else
+        {
+            // a typo: spot it, hit enter to start again and pick a word again
+            typist.keys += static_cast<char>(wrongKey(typist.randomEngine));
+            typist.keys += '\n';
+            typist.target.clear();
+        }
+    }
+    return typist.keys;
+}
+
+struct phaseTimes
+{
+    const char *name;
+    chrono::nanoseconds total{0};
+};
+
+// a slow, an average and a fast typist (keys a step, accuracy), each playing their own game
+const array<pair<double, double>, 3> BENCHMARK_TYPISTS{{{0.075, 0.90}, {0.15, 0.95}, {0.375, 0.98}}};
+
+// one classic step written out by hand, the way a tick looked before there were modes: no
+// function pointers and no rules structs, so the benchmark can show what they cost
+auto ClassicTickByHand(gameSession &session, const dictionary &wordList) -> void
+{
+    session.ticks += 1;
+    if (session.ticks % SPAWN_INTERVAL_STEPS == 0)
+    {
+        session.dirty = true;
+        CreateWord(session.activeWords, session.index, session.matcher, session.lanes, wordList, session.randomEngine, session.ticks,
+                   [&wordList](default_random_engine &randomEngine) { return PickWord(wordList, randomEngine); });
+    }
+    wordStore &words{session.activeWords};
+    const playLayout &layout{session.layout};
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        words.position[i] += words.speed[i];
+        int proposedCol{words.position[i] >> SUBCELL_BITS};
+        unsigned int colour{proposedCol >= layout.redStart ? COLOUR_RED : proposedCol >= layout.yellowStart ? COLOUR_YELLOW : words.colour[i]};
+        int newCol{min(layout.fieldWidth - words.width[i], proposedCol)};
+        session.dirty = session.dirty or newCol != words.col[i] or colour != words.colour[i];
+        bool wasClear{LaneClearOf(words, i)};
+        words.col[i] = newCol;
+        words.colour[i] = colour;
+        int lane{words.row[i] - session.lanes.firstRow};
+        if (not wasClear and session.lanes.tailSlot[lane] == static_cast<int>(i) and LaneClearOf(words, i))
+        {
+            SetLaneFree(session.lanes, lane, true);
+        }
+    }
+    // 10 points a letter and a life a miss are the only rules the clear pass has
+    unsigned int countBefore{words.count};
+    ClearWords<lengthScoring, fiveLives>(words, session.index, session.matcher, session.lanes, layout, session.score, session.lives, session.stats, session.ticks);
+    session.dirty = session.dirty or words.count != countBefore;
+}
+
+// plays the same classic games as RunBenchmark, moving them on with runTick, returns how
+// long the ticks took and the checksum of how the games went
+template <typename tickType>
+auto TimeClassicTicks(const dictionary &wordList, unsigned long long tickCount, unsigned int benchmarkSeed, tickType runTick, unsigned long long &checksum) -> chrono::nanoseconds
+{
+    vector<unique_ptr<gameSession>> sessions;
+    vector<scriptedTypist> typists;
+    for (unsigned int number = 0; number < BENCHMARK_TYPISTS.size(); number++)
+    {
+        sessions.push_back(make_unique<gameSession>());
+        StartSession(*sessions.back(), SESSION_ROWS, SESSION_COLS, SESSION_WORD_CAPACITY, benchmarkSeed + number);
+        typists.push_back({BENCHMARK_TYPISTS[number].first, BENCHMARK_TYPISTS[number].second, default_random_engine(benchmarkSeed * 31 + number)});
+    }
+    unsigned long long gamesPlayed{0};
+    checksum = 0;
+    chrono::nanoseconds tickTime{0};
+    for (unsigned long long tick = 0; tick < tickCount; tick += sessions.size())
+    {
+        for (unsigned int number = 0; number < sessions.size(); number++)
+        {
+            gameSession &session{*sessions[number]};
+            FeedSessionInput(session, ScriptTypist(typists[number], session));
+            ConsumeSessionInput(session);
+            auto tickStart{chrono::steady_clock::now()};
+            runTick(session, wordList);
+            tickTime += chrono::steady_clock::now() - tickStart;
+            if (session.dirty)
+            {
+                DrawGameFrame(session);
+            }
+            if (SessionOver(session))
+            {
+                checksum = checksum * 1000003 + session.score * 31 + session.ticks;
+                gamesPlayed += 1;
+                FinishSessionStats(session);
+                StartSession(session, SESSION_ROWS, SESSION_COLS, SESSION_WORD_CAPACITY, benchmarkSeed + sessions.size() * gamesPlayed + number);
+                typists[number].target.clear();
+            }
+        }
+    }
+    for (auto &session : sessions)
+    {
+        checksum = checksum * 1000003 + session->score * 31 + session->ticks;
+        FinishSessionStats(*session);
+    }
+    return tickTime;
+}
+
+// --benchmark [ticks] [seed] [mode]
+auto RunBenchmark(unsigned long long tickCount, unsigned int benchmarkSeed, const gameMode &mode) -> int
+{
+    dictionary wordList;
+    if (not LoadCompiledWordList("wordlist.tsd", wordList) and not LoadWordList("wordlist.txt", wordList))
+    {
+        cerr << "couldn't load any words from wordlist.txt" << endl;
+        return EXIT_FAILURE;
+    }
+    vector<unique_ptr<gameSession>> sessions;
+    vector<scriptedTypist> typists;
+    for (unsigned int number = 0; number < BENCHMARK_TYPISTS.size(); number++)
+    {
+        sessions.push_back(make_unique<gameSession>());
+        StartSession(*sessions.back(), SESSION_ROWS, SESSION_COLS, SESSION_WORD_CAPACITY, benchmarkSeed + number, mode);
+        typists.push_back({BENCHMARK_TYPISTS[number].first, BENCHMARK_TYPISTS[number].second, default_random_engine(benchmarkSeed * 31 + number)});
+    }
+
+    array<phaseTimes, 6> phases{{{"typist"}, {"input"}, {"spawn"}, {"move"}, {"clear"}, {"draw"}}};
+    unsigned long long gamesPlayed{0};
+    unsigned long long checksum{0};
+    unsigned long long allocationsBefore{AllocationsSoFar()};
+    auto startTime{chrono::steady_clock::now()};
+    for (unsigned long long tick = 0; tick < tickCount; tick += sessions.size())
+    {
+        for (unsigned int number = 0; number < sessions.size(); number++)
+        {
+            gameSession &session{*sessions[number]};
+            auto phaseStart{chrono::steady_clock::now()};
+            auto endPhase{[&phases, &phaseStart](unsigned int phase)
+                          {
+                              auto now{chrono::steady_clock::now()};
+                              phases[phase].total += now - phaseStart;
+                              phaseStart = now;
+                          }};
+            FeedSessionInput(session, ScriptTypist(typists[number], session));
+            endPhase(0);
+            ConsumeSessionInput(session);
+            endPhase(1);
+            session.mode->spawn(session, wordList);
+            endPhase(2);
+            session.mode->move(session);
+            endPhase(3);
+            session.mode->clear(session);
+            endPhase(4);
+            if (session.dirty)
+            { // the same rule the game uses, minus the frame rate cap
+                DrawGameFrame(session);
+            }
+            endPhase(5);
+            CheckTraceDumpRequest();
+            if (SessionOver(session))
+            {
+                checksum = checksum * 1000003 + session.score * 31 + session.ticks;
+                gamesPlayed += 1;
+                FinishSessionStats(session);
+                StartSession(session, SESSION_ROWS, SESSION_COLS, SESSION_WORD_CAPACITY, benchmarkSeed + sessions.size() * gamesPlayed + number, mode);
+                typists[number].target.clear();
+            }
+        }
+    }
+    chrono::duration<double> elapsed{chrono::steady_clock::now() - startTime};
+    unsigned long long allocations{AllocationsSoFar() - allocationsBefore};
+    unsigned long long ticksRun{(tickCount + sessions.size() - 1) / sessions.size() * sessions.size()};
+    for (auto &session : sessions)
+    {
+        checksum = checksum * 1000003 + session->score * 31 + session->ticks;
+        FinishSessionStats(*session);
+    }
+
+    cout << "mode: " << mode.name << " ticks: " << ticksRun << " in " << elapsed.count() << "s ("
+         << static_cast<unsigned long long>(ticksRun / elapsed.count()) << " ticks/sec)" << endl;
+    cout << "games finished: " << gamesPlayed << " checksum: " << checksum << endl;
+    if (COUNTING_ALLOCATIONS)
+    {
+        cout << "allocations: " << allocations << " (" << static_cast<double>(allocations) / ticksRun << " per tick)" << endl;
+    }
+    else
+    {
+        cout << "allocations: not counted (compile with -DTYPESPEED_COUNT_ALLOCATIONS)" << endl;
+    }
+    for (const auto &phase : phases)
+    {
+        cout << "  " << phase.name << ": " << static_cast<double>(phase.total.count()) / ticksRun << " ns/tick" << endl;
+    }
+    PrintTypingStats(cerr, processTypingStats);
+    // classic is played twice more, timing just the ticks: once through the mode and once
+    // with the tick written out by hand, to show what the modes cost
+    bool matched{true};
+    if (&mode == &GAME_MODES[MODE_CLASSIC])
+    {
+        unsigned long long modeChecksum{0};
+        unsigned long long byHandChecksum{0};
+        chrono::nanoseconds modeTime{TimeClassicTicks(wordList, tickCount, benchmarkSeed, [](gameSession &session, const dictionary &words)
+                                                      { RunSessionTick(session, words); }, modeChecksum)};
+        chrono::nanoseconds byHandTime{TimeClassicTicks(wordList, tickCount, benchmarkSeed, [](gameSession &session, const dictionary &words)
+                                                        { ClassicTickByHand(session, words); }, byHandChecksum)};
+        matched = modeChecksum == checksum and byHandChecksum == checksum;
+        cout << "classic tick through the mode: " << static_cast<double>(modeTime.count()) / ticksRun << " ns/tick, written out by hand: "
+             << static_cast<double>(byHandTime.count()) / ticksRun << " ns/tick" << (matched ? "" : " MISMATCH") << endl;
+    }
+    UnloadWordList(wordList);
+    return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// keeps a session topped up to wordCount words and runs ticks on it, timing the move and
+// clear phases; returns a hash of where everything ended up so runs can be compared
+auto RunScalingTicks(const dictionary &wordList, unsigned int wordCount, tickPool *pool, chrono::nanoseconds &timed, unsigned long long &wordsTimed) -> uint64_t
+{
+    const unsigned int WARMUP_TICKS{600}; // long enough for the first words to reach the boundary
+    const unsigned int TIMED_TICKS{300};
+    auto session{make_unique<gameSession>()};
+    // zen rules so missed words don't end the game, and a lane for every few words
+    StartSession(*session, wordCount / 3 + BORDER_HEIGHT, BORDER_WIDTH, wordCount, 1, *FindGameMode("zen"));
+    session->parallel.pool = pool;
+    wordStore &words{session->activeWords};
+    timed = chrono::nanoseconds(0);
+    wordsTimed = 0;
+    for (unsigned int tick = 0; tick < WARMUP_TICKS + TIMED_TICKS; tick++)
+    {
+        while (words.count < wordCount)
+        {
+            unsigned int countBefore{words.count};
+            CreateWord(words, session->index, session->matcher, session->lanes, wordList, session->randomEngine, session->ticks,
+                       [&wordList](default_random_engine &randomEngine) { return PickWord(wordList, randomEngine); });
+            if (words.count == countBefore)
+            {
+                break; // every lane is busy
+            }
+        }
+        // somebody types a word out now and then, and always has a letter or two typed
+        for (unsigned int i = tick % 97; i < words.count; i += 97)
+        {
+            words.cleared[i] = true;
+        }
+        FeedSessionInput(*session, tick % 10 == 0 ? "\ns" : "t");
+        ConsumeSessionInput(*session);
+        session->mode->spawn(*session, wordList);
+        auto startTime{chrono::steady_clock::now()};
+        session->mode->move(*session);
+        session->mode->clear(*session);
+        if (tick >= WARMUP_TICKS)
+        {
+            timed += chrono::steady_clock::now() - startTime;
+            wordsTimed += words.count;
+        }
+    }
+
+    uint64_t hash{14695981039346656037ULL};
+    auto mix{[&hash](uint64_t value)
+             { hash = (hash ^ value) * 1099511628211ULL; }};
+    mix(session->score);
+    mix(session->lives);
+    mix(words.count);
+    for (unsigned int i = 0; i < words.count; i++)
+    {
+        mix(WordNumberOf(wordList, words.content[i]));
+        mix(words.row[i]);
+        mix(static_cast<uint64_t>(words.position[i]));
+        mix(words.colour[i]);
+        // and the lookups have to agree with the store
+        const auto &positions{session->index.at(words.content[i])};
+        mix(find(positions.begin(), positions.end(), i) != positions.end());
+    }
+    for (auto candidate : session->matcher.candidates)
+    {
+        mix(candidate);
+    }
+    for (auto tail : session->lanes.tailSlot)
+    {
+        mix(static_cast<uint64_t>(tail));
+    }
+    for (auto lanes : session->lanes.freeLanes)
+    {
+        mix(lanes);
+    }
+    mix(session->stats.wordsCleared);
+    return hash;
+}
+
+// --tick-scaling-benchmark [words] [threads]
+// times the move and clear phases of one session with that many words on screen, spread
+// over 1 to threads threads; the speedups are against the pooled pass on 1 thread, so
+// they're only down to the threads. The plain single threaded pass (a different way of
+// clearing words) is timed too and its gain reported on its own. Fails if any run ends
+// up somewhere different from the single threaded one
+auto RunTickScalingBenchmark(unsigned int wordCount, unsigned int maxThreads) -> int
+{
+    dictionary wordList;
+    if (not LoadCompiledWordList("wordlist.tsd", wordList) and not LoadWordList("wordlist.txt", wordList))
+    {
+        cerr << "couldn't load any words from wordlist.txt" << endl;
+        return EXIT_FAILURE;
+    }
+    chrono::nanoseconds serialTime{0};
+    unsigned long long wordsTimed{0};
+    uint64_t serialHash{RunScalingTicks(wordList, wordCount, nullptr, serialTime, wordsTimed)};
+    cout << "words: " << wordsTimed / 300 << " on average (split up from " << PARALLEL_TICK_WORDS << ", " << TICK_CHUNK_WORDS << " a chunk)" << endl;
+    bool allMatched{true};
+    chrono::nanoseconds oneThreadTime{0};
+    for (unsigned int threadCount = 1; threadCount <= maxThreads; threadCount++)
+    {
+        tickPool pool;
+        StartTickPool(pool, threadCount);
+        chrono::nanoseconds parallelTime{0};
+        uint64_t parallelHash{RunScalingTicks(wordList, wordCount, &pool, parallelTime, wordsTimed)};
+        StopTickPool(pool);
+        bool matched{parallelHash == serialHash};
+        allMatched = allMatched and matched;
+        if (threadCount == 1)
+        {
+            oneThreadTime = parallelTime;
+        }
+        cout << "  " << threadCount << (threadCount == 1 ? " thread:  " : " threads: ") << chrono::duration<double, micro>(parallelTime).count() / 300
+             << " us/tick (" << static_cast<double>(oneThreadTime.count()) / parallelTime.count() << "x)" << (matched ? "" : " MISMATCH") << endl;
+    }
+    // the pooled pass remaps the lookups a bucket at a time rather than word by word, which
+    // is a gain of its own whatever the thread count
+    cout << "single threaded pass: " << chrono::duration<double, micro>(serialTime).count() / 300
+         << " us/tick (" << static_cast<double>(serialTime.count()) / oneThreadTime.count() << "x as long as the pooled pass on 1 thread)" << endl;
+    UnloadWordList(wordList);
+    return allMatched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// --ranking-check [players] [seed]
+// gives random players random best scores (some raised again, some past the last bucket, a
+// crowd of them tied on one score) and checks BucketAtRank and PlayerAtRank against walking
+// byScore from the top for every rank
+auto RunRankingCheck(unsigned int playerCount, unsigned int seed) -> int
+{
+    highScoreStore store;
+    mt19937 randomEngine(seed);
+    uniform_int_distribution<unsigned int> scoreDistribution(0, 2000);
+    for (unsigned int number = 0; number < playerCount; number++)
+    {
+        string userName{"player" + to_string(number)};
+        UpdateBestScore(store, userName, scoreDistribution(randomEngine) * SCORE_BUCKET_WIDTH);
+        if (number % 7 == 0)
+        {
+            UpdateBestScore(store, userName, scoreDistribution(randomEngine) * SCORE_BUCKET_WIDTH);
+        }
+        if (number % 101 == 100)
+        {
+            UpdateBestScore(store, userName, MAX_SCORE_BUCKETS * SCORE_BUCKET_WIDTH + scoreDistribution(randomEngine));
+        }
+        if (number % 4 == 0)
+        {
+            UpdateBestScore(store, "tied" + to_string(number), 1000 * SCORE_BUCKET_WIDTH);
+        }
+    }
+
+    unsigned int wrongBuckets{0};
+    unsigned int wrongPlayers{0};
+    unsigned int rank{1};
+    for (auto player = store.byScore.begin(); player != store.byScore.end(); player++, rank++)
+    {
+        if (BucketAtRank(store.ranking, rank) != ScoreBucket(player->first))
+        {
+            wrongBuckets++;
+        }
+        if (PlayerAtRank(store, rank) != player)
+        {
+            wrongPlayers++;
+        }
+    }
+    bool pastEnd{PlayerAtRank(store, rank) == store.byScore.end() and PlayerAtRank(store, 0) == store.byScore.end()};
+
+    cout << "players: " << store.ranking.players << " (" << max<size_t>(store.ranking.tree.size(), 1) - 1 << " buckets)" << endl;
+    cout << "  wrong buckets: " << wrongBuckets << endl;
+    cout << "  wrong players: " << wrongPlayers << endl;
+    cout << "  ranks out of range: " << (pastEnd ? "ok" : "WRONG") << endl;
+    return wrongBuckets == 0 and wrongPlayers == 0 and pastEnd ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// --typing-check
+// puts a few words on screen, types at them and checks which ones get cleared: a word that
+// starts a longer one waits for enter, and a command is never eaten by a word it starts with
+auto RunTypingCheck() -> int
+{
+    char listName[]{"/tmp/typespeed-words-XXXXXX"};
+    int listFd{mkstemp(listName)};
+    string_view listText{"car\ncart\npa\nqu\ndog\n"};
+    bool written{listFd >= 0 and write(listFd, listText.data(), listText.length()) == static_cast<ssize_t>(listText.length())};
+    if (listFd >= 0)
+    {
+        close(listFd);
+    }
+    dictionary wordList;
+    bool loaded{written and LoadWordList(listName, wordList)};
+    unlink(listName);
+    if (not loaded)
+    {
+        cerr << "couldn't write a word list to check with" << endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int wrong{0};
+    auto check{[&wordList, &wrong](const char *name, initializer_list<string_view> onScreen, string_view keys, initializer_list<string_view> cleared, bool paused, bool quit)
+               {
+                   auto session{make_unique<gameSession>()};
+                   StartSession(*session, BORDER_HEIGHT + ROWS_BELOW_FIELD, BORDER_WIDTH, 16, 1);
+                   for (auto content : onScreen)
+                   {
+                       unsigned int number{0};
+                       while (WordAt(wordList, number) != content)
+                       {
+                           number += 1;
+                       }
+                       CreateWord(session->activeWords, session->index, session->matcher, session->lanes, wordList, session->randomEngine, session->ticks,
+                                  [number](default_random_engine &) { return number; });
+                   }
+                   FeedSessionInput(*session, keys);
+                   ConsumeSessionInput(*session);
+                   const wordStore &words{session->activeWords};
+                   bool right{words.count == onScreen.size() and session->paused == paused and session->quit == quit};
+                   for (unsigned int i = 0; i < words.count; i++)
+                   {
+                       right = right and words.cleared[i] == (find(cleared.begin(), cleared.end(), words.content[i]) != cleared.end());
+                   }
+                   cout << "  " << name << ": " << (right ? "ok" : "WRONG") << endl;
+                   wrong += not right;
+               }};
+    check("a word on its own clears without enter", {"dog"}, "dog", {"dog"}, false, false);
+    check("car waits while cart still matches", {"car", "cart"}, "car", {}, false, false);
+    check("cart can be typed past car", {"car", "cart"}, "cart", {"cart"}, false, false);
+    check("enter clears car", {"car", "cart"}, "car\n", {"car"}, false, false);
+    check("pause isn't eaten by pa", {"pa"}, "pause\n", {}, true, false);
+    check("quit isn't eaten by qu", {"qu"}, "quit\n", {}, false, true);
+    check("enter still clears pa", {"pa"}, "pa\n", {"pa"}, false, false);
+    UnloadWordList(wordList);
+    return wrong == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// the way words used to be drawn, kept so --escape-benchmark has something to compare against
+auto StreamMoveTo(ostream &output, unsigned int x, unsigned int y) -> void { output << ANSI_START << x << ";" << y << "H" << flush; }
+auto StringMakeColour(string inputString, const unsigned int foregroundColour = COLOUR_WHITE) -> string
+{
+    string outputString;
+    outputString += ANSI_START;
+    outputString += START_COLOUR_PREFIX;
+    outputString += to_string(foregroundColour);
+    outputString += START_COLOUR_SUFFIX;
+    outputString += inputString;
+    outputString += STOP_COLOUR;
+    return outputString;
+}
+
+// --escape-benchmark [words]
+// draws the same words (a move, a colour and the word each) through the old ostream and
+// MakeColour path and through the escape tables, and checks both write the same bytes.
+// Both write to /dev/null the way the game wrote to the terminal: the old path with the
+// flush (so a write()) after every move and every word, the tables once a frame.
+auto RunEscapeBenchmark(unsigned long long wordCount) -> int
+{
+    dictionary wordList;
+    if (not LoadCompiledWordList("wordlist.tsd", wordList) and not LoadWordList("wordlist.txt", wordList))
+    {
+        cerr << "couldn't load any words from wordlist.txt" << endl;
+        return EXIT_FAILURE;
+    }
+    ofstream streamSink("/dev/null");
+    int tableSink{open("/dev/null", O_WRONLY | O_CLOEXEC)};
+    if (not streamSink or tableSink < 0)
+    {
+        cerr << "couldn't open /dev/null [" << errno << "]" << endl;
+        if (tableSink >= 0)
+        {
+            close(tableSink);
+        }
+        UnloadWordList(wordList);
+        return EXIT_FAILURE;
+    }
+    const array<unsigned int, 3> COLOURS{COLOUR_GREEN, COLOUR_YELLOW, COLOUR_RED};
+    const unsigned long long FRAME_WORDS{64}; // the output is thrown away after this many, like a frame
+    auto drawWord{[&wordList, &COLOURS](unsigned long long number, auto draw)
+                  {
+                      draw(2 + number % BORDER_HEIGHT, 1 + number * 7 % BORDER_WIDTH, WordAt(wordList, number % wordList.wordCount), COLOURS[number % COLOURS.size()]);
+                  }};
+
+    auto streamWord{[](ostream &stream)
+                    {
+                        return [&stream](unsigned int row, unsigned int col, string_view word, unsigned int colour)
+                        {
+                            StreamMoveTo(stream, row, col);
+                            stream << StringMakeColour(string(word), colour) << flush;
+                        };
+                    }};
+    unsigned long long allocationsBefore{AllocationsSoFar()};
+    auto startTime{chrono::steady_clock::now()};
+    for (unsigned long long number = 0; number < wordCount; number++)
+    {
+        drawWord(number, streamWord(streamSink));
+    }
+    chrono::duration<double, nano> streamTime{chrono::steady_clock::now() - startTime};
+    unsigned long long streamAllocations{AllocationsSoFar() - allocationsBefore};
+    // the last frame again, untimed, into memory to check the bytes against
+    ostringstream stream;
+    for (unsigned long long number = wordCount - (wordCount - 1) % FRAME_WORDS - 1; number < wordCount; number++)
+    {
+        drawWord(number, streamWord(stream));
+    }
+    string streamFrame{stream.str()};
+
+    string output;
+    output.reserve(FRAME_WORDS * 64);
+    allocationsBefore = AllocationsSoFar();
+    startTime = chrono::steady_clock::now();
+    for (unsigned long long number = 0; number < wordCount; number++)
+    {
+        if (number % FRAME_WORDS == 0)
+        {
+            output.clear();
+        }
+        drawWord(number, [&output](unsigned int row, unsigned int col, string_view word, unsigned int colour)
+                 {
+                     AppendCursorMove(output, row, col);
+                     AppendColoured(output, word, colour);
+                 });
+        if (number % FRAME_WORDS == FRAME_WORDS - 1 or number == wordCount - 1)
+        {
+            WriteAll(tableSink, output.data(), output.size());
+        }
+    }
+    chrono::duration<double, nano> tableTime{chrono::steady_clock::now() - startTime};
+    close(tableSink);
+    unsigned long long tableAllocations{AllocationsSoFar() - allocationsBefore};
+
+    cout << "words: " << wordCount << endl;
+    cout << "  (both written to /dev/null, the old way flushing twice a word, the new way once every " << FRAME_WORDS << " words)" << endl;
+    cout << "  ostream + MakeColour: " << streamTime.count() / wordCount << " ns/word";
+    if (COUNTING_ALLOCATIONS)
+    {
+        cout << ", " << static_cast<double>(streamAllocations) / wordCount << " allocations/word";
+    }
+    cout << endl
+         << "  escape tables:        " << tableTime.count() / wordCount << " ns/word";
+    if (COUNTING_ALLOCATIONS)
+    {
+        cout << ", " << static_cast<double>(tableAllocations) / wordCount << " allocations/word";
+    }
+    cout << endl;
+    if (not COUNTING_ALLOCATIONS)
+    {
+        cout << "  allocations: not counted (compile with -DTYPESPEED_COUNT_ALLOCATIONS)" << endl;
+    }
+    UnloadWordList(wordList);
+    if (streamFrame != output)
+    {
+        cout << "MISMATCH: the two ways wrote different bytes" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Latency Benchmark
+// --latency-benchmark runs the real game under a pseudo terminal and plays it like a
+// person would, timing how long each keystroke takes to show up on screen. The game's
+// output is fed through a tiny terminal emulator (just the escape codes the game uses),
+// and the size query GetTerminalSize sends is answered the way a terminal would. The
+// game runs in a scratch directory so its score doesn't end up in the real high scores.
+
+const int LATENCY_ROWS{40};
+const int LATENCY_COLS{100};
+const int LATENCY_TIMEOUT_MS{2000}; // a key that takes longer than this to show up counts as lost
+
+// just enough of a terminal to follow what the game draws
+struct virtualTerminal
+{
+    int rows{LATENCY_ROWS};
+    int cols{LATENCY_COLS};
+    vector<char> cells;
+    int row{1};
+    int col{1};
+    int state{0}; // 0 = text, 1 = just had an ESC, 2 = inside ESC[
+    string parameters;
+    string replies; // what the terminal has to answer (the cursor position report)
+};
+
+auto TerminalRow(const virtualTerminal &term, int row) -> string_view
+{
+    string_view text(&term.cells[(row - 1) * term.cols], term.cols);
+    auto lastUsed{text.find_last_not_of(' ')};
+    return text.substr(0, lastUsed == string_view::npos ? 0 : lastUsed + 1);
+}
+
+auto TerminalContains(const virtualTerminal &term, string_view text) -> bool
+{
+    for (int row = 1; row <= term.rows; row++)
+    {
+        if (TerminalRow(term, row).find(text) != string_view::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto TerminalNewLine(virtualTerminal &term) -> void
+{
+    term.col = 1;
+    if (term.row < term.rows)
+    {
+        term.row += 1;
+        return;
+    }
+    // scroll everything up a line
+    copy(term.cells.begin() + term.cols, term.cells.end(), term.cells.begin());
+    fill(term.cells.end() - term.cols, term.cells.end(), ' ');
+}
+
+auto RunTerminalCommand(virtualTerminal &term, char command) -> void
+{
+    vector<int> numbers;
+    string_view parameters(term.parameters);
+    if (not parameters.empty() and parameters[0] == '?')
+    {
+        parameters.remove_prefix(1);
+    }
+    while (not parameters.empty())
+    {
+        int number{0};
+        auto [end, error]{from_chars(parameters.data(), parameters.data() + parameters.size(), number)};
+        numbers.push_back(error == errc() ? number : 0);
+        auto semicolon{parameters.find(';')};
+        parameters = (semicolon == string_view::npos) ? string_view() : parameters.substr(semicolon + 1);
+    }
+    auto numberAt{[&numbers](size_t position, int fallback)
+                  { return (position < numbers.size() and numbers[position] > 0) ? numbers[position] : fallback; }};
+    if (command == 'H')
+    {
+        term.row = clamp(numberAt(0, 1), 1, term.rows);
+        term.col = clamp(numberAt(1, 1), 1, term.cols);
+    }
+    else if (command == 'C')
+    {
+        term.col = min(term.cols, term.col + numberAt(0, 1));
+    }
+    else if (command == 'J' and numberAt(0, 0) == 2)
+    {
+        fill(term.cells.begin(), term.cells.end(), ' ');
+    }
+    else if (command == 'n' and numberAt(0, 0) == 6)
+    {
+        term.replies += "\033[" + to_string(term.row) + ";" + to_string(term.col) + "R";
+    }
+    // colours and showing / hiding the cursor don't change what's on screen
+}
+
+auto FeedTerminal(virtualTerminal &term, const char *data, size_t length) -> void
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        char current{data[i]};
+        if (term.state == 1)
+        {
+            term.state = (current == '[') ? 2 : 0;
+            term.parameters.clear();
+        }
+        else if (term.state == 2)
+        {
+            if (current >= 0x30 and current <= 0x3f)
+            {
+                term.parameters += current;
+            }
+            else
+            {
+                RunTerminalCommand(term, current);
+                term.state = 0;
+            }
+        }
+        else if (current == '\033')
+        {
+            term.state = 1;
+        }
+        else if (current == '\r')
+        {
+            term.col = 1;
+        }
+        else if (current == '\n')
+        {
+            TerminalNewLine(term);
+        }
+        else if ((current >= 0x20 and current < 0x7f) or (static_cast<unsigned char>(current) >= 0xc0))
+        {
+            // the start of a UTF-8 character takes a cell, the rest of its bytes don't
+            if (term.col > term.cols)
+            {
+                TerminalNewLine(term);
+            }
+            term.cells[(term.row - 1) * term.cols + (term.col - 1)] = (current < 0x7f and current >= 0x20) ? current : '?';
+            term.col += 1;
+        }
+    }
+}
+
+struct latencyHarness
+{
+    int masterFd{-1};
+    virtualTerminal term;
+    bool childExited{false};
+};
+
+// reads whatever the game has written within timeoutMs, returns false once the game has gone
+auto PumpHarness(latencyHarness &harness, int timeoutMs) -> bool
+{
+    struct pollfd watched{harness.masterFd, POLLIN, 0};
+    if (poll(&watched, 1, timeoutMs) <= 0)
+    {
+        return not harness.childExited;
+    }
+    char chunk[65536];
+    auto bytesRead{read(harness.masterFd, chunk, sizeof(chunk))};
+    if (bytesRead <= 0)
+    {
+        harness.childExited = true;
+        return false;
+    }
+    FeedTerminal(harness.term, chunk, bytesRead);
+    if (not harness.term.replies.empty())
+    {
+        WriteAll(harness.masterFd, harness.term.replies.data(), harness.term.replies.size());
+        harness.term.replies.clear();
+    }
+    return true;
+}
+
+// keeps reading until the screen passes the check, returns how long that took (or -1 on timeout)
+template <typename checkType>
+auto WaitForScreen(latencyHarness &harness, checkType check, int timeoutMs = LATENCY_TIMEOUT_MS) -> double
+{
+    auto startTime{chrono::steady_clock::now()};
+    auto deadline{startTime + chrono::milliseconds(timeoutMs)};
+    while (not check(harness.term))
+    {
+        auto now{chrono::steady_clock::now()};
+        if (now >= deadline or not PumpHarness(harness, static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - now).count()) + 1))
+        {
+            return -1;
+        }
+    }
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+}
+
+// presses one key and times how long it takes until the screen passes the check
+template <typename checkType>
+auto PressAndTime(latencyHarness &harness, char key, checkType check) -> double
+{
+    WriteAll(harness.masterFd, &key, 1);
+    return WaitForScreen(harness, check);
+}
+
+auto CommandLineIs(const string &typed)
+{
+    return [expected = "Command: " + typed](const virtualTerminal &term)
+    { return TerminalRow(term, ComputeLayout(term.rows, term.cols).commandRow) == string_view(expected).substr(0, expected.find_last_not_of(' ') + 1); };
+}
+
+struct wordOnScreen
+{
+    string text;
+    int row;
+};
+
+// the word furthest to the left inside the play area, so it's the least likely to reach the edge while it's typed
+// (passing over any that start a longer word on screen, those only clear on enter)
+auto FindWordOnScreen(const virtualTerminal &term, wordOnScreen &found) -> bool
+{
+    vector<pair<int, wordOnScreen>> onScreen; // start column and the word
+    playLayout layout{ComputeLayout(term.rows, term.cols)};
+    for (int row = 2; row < layout.fieldHeight; row++)
+    {
+        string_view line{TerminalRow(term, row)};
+        line = line.substr(0, min<size_t>(line.length(), layout.fieldWidth - 1));
+        size_t position{1};
+        while (position < line.length())
+        {
+            size_t start{line.find_first_not_of(" |", position)};
+            if (start == string_view::npos)
+            {
+                break;
+            }
+            size_t end{min(line.find_first_of(" |", start), line.length())};
+            if (start >= 2)
+            {
+                onScreen.push_back({static_cast<int>(start), {string(line.substr(start, end - start)), row}});
+            }
+            position = end;
+        }
+    }
+    int bestStart{INT_MAX};
+    for (const auto &[start, word] : onScreen)
+    {
+        bool startsLonger{any_of(onScreen.begin(), onScreen.end(), [&word](const auto &other)
+                                 { return other.second.text.length() > word.text.length() and other.second.text.starts_with(word.text); })};
+        if (not startsLonger and start < bestStart)
+        {
+            bestStart = start;
+            found = word;
+        }
+    }
+    return bestStart != INT_MAX;
+}
+
+auto RecordLatency(double latency, vector<double> &samples, unsigned int &lostKeys) -> void
+{
+    if (latency >= 0)
+    {
+        samples.push_back(latency);
+    }
+    else
+    {
+        lostKeys += 1;
+    }
+}
+
+auto PrintPercentiles(const char *label, vector<double> &samples) -> void
+{
+    cout << label << ": ";
+    if (samples.empty())
+    {
+        cout << "no samples" << endl;
+        return;
+    }
+    sort(samples.begin(), samples.end());
+    auto percentile{[&samples](double fraction)
+                    { return samples[min(samples.size() - 1, static_cast<size_t>(ceil(fraction * samples.size())) - 1)]; }};
+    cout << samples.size() << " samples, p50 " << percentile(0.50) << "us p99 " << percentile(0.99)
+         << "us p999 " << percentile(0.999) << "us max " << samples.back() << "us" << endl;
+}
+
+// --latency-benchmark [keystrokes]
+auto RunLatencyBenchmark(unsigned int keyCount) -> int
+{
+    char scratchName[]{"/tmp/typespeed-latency-XXXXXX"};
+    if (mkdtemp(scratchName) == nullptr)
+    {
+        cerr << "couldn't make a scratch directory [" << errno << "]" << endl;
+        return EXIT_FAILURE;
+    }
+    filesystem::path scratch{scratchName};
+    for (const char *fileName : {"wordlist.txt", "wordlist.tsd"})
+    {
+        if (filesystem::exists(fileName))
+        {
+            filesystem::create_symlink(filesystem::absolute(fileName), scratch / fileName);
+        }
+    }
+    string program{filesystem::read_symlink("/proc/self/exe")};
+
+    latencyHarness harness;
+    harness.term.cells.assign(LATENCY_ROWS * LATENCY_COLS, ' ');
+    struct winsize size{};
+    size.ws_row = LATENCY_ROWS;
+    size.ws_col = LATENCY_COLS;
+    pid_t child{forkpty(&harness.masterFd, nullptr, nullptr, &size)};
+    if (child < 0)
+    {
+        cerr << "forkpty failed [" << errno << "]" << endl;
+        filesystem::remove_all(scratch);
+        return EXIT_FAILURE;
+    }
+    if (child == 0)
+    {
+        // the game: debug output would land on the "screen", so throw it away
+        int devNull{open("/dev/null", O_WRONLY)};
+        dup2(devNull, 2);
+        if (chdir(scratchName) == 0)
+        {
+            execl(program.c_str(), program.c_str(), nullptr);
+        }
+        _exit(127);
+    }
+
+    vector<double> echoLatency;
+    vector<double> clearLatency;
+    vector<double> enterLatency;
+    unsigned int lostKeys{0};   // keys that never showed up on the screen
+    unsigned int edgeLosses{0}; // words that reached the edge before they were typed, which is the game's doing
+    default_random_engine randomEngine(1);
+    uniform_int_distribution<int> thinkTime(5, 30); // ms between keys, so presses land all over the tick
+    bool started{WaitForScreen(harness, [](const virtualTerminal &term)
+                               { return TerminalContains(term, "to see rules"); }, 5000) >= 0};
+    if (started)
+    {
+        WriteAll(harness.masterFd, "start\n", 6);
+        started = WaitForScreen(harness, [](const virtualTerminal &term)
+                                { return TerminalContains(term, "what's your name"); }) >= 0;
+    }
+    if (started)
+    {
+        WriteAll(harness.masterFd, "latency\n", 8);
+        started = WaitForScreen(harness, CommandLineIs("")) >= 0;
+    }
+    if (not started)
+    {
+        cerr << "the game never got to the play screen" << endl;
+    }
+
+    auto deadline{chrono::steady_clock::now() + chrono::minutes(5)};
+    while (started and not harness.childExited and echoLatency.size() + clearLatency.size() + enterLatency.size() < keyCount and chrono::steady_clock::now() < deadline)
+    {
+        wordOnScreen target;
+        if (FindWordOnScreen(harness.term, target))
+        {
+            // type the word out, the last key should make it disappear
+            string typed;
+            bool lost{false};
+            for (size_t i = 0; i < target.text.length() and not lost; i++)
+            {
+                PumpHarness(harness, thinkTime(randomEngine));
+                typed += target.text[i];
+                double latency;
+                if (typed.length() < target.text.length())
+                {
+                    latency = PressAndTime(harness, target.text[i], CommandLineIs(typed));
+                    if (latency >= 0)
+                    {
+                        echoLatency.push_back(latency);
+                    }
+                }
+                else
+                {
+                    latency = PressAndTime(harness, target.text[i], [&target](const virtualTerminal &term)
+                                           { return TerminalRow(term, ComputeLayout(term.rows, term.cols).commandRow) == "Command:" and
+                                                    TerminalRow(term, target.row).find(target.text) == string_view::npos; });
+                    if (latency >= 0)
+                    {
+                        clearLatency.push_back(latency);
+                    }
+                }
+                lost = latency < 0;
+            }
+            if (lost)
+            { // if what was typed did show up the word just reached the edge first, otherwise the key was lost
+                if (CommandLineIs(typed)(harness.term))
+                {
+                    edgeLosses += 1;
+                }
+                else
+                {
+                    lostKeys += 1;
+                }
+                WriteAll(harness.masterFd, "\n", 1);
+                WaitForScreen(harness, CommandLineIs(""));
+            }
+        }
+        else
+        {
+            // nothing to type yet: type a few keys that can't match a word, then enter
+            string typed;
+            for (char key : {'7', '8', '9'})
+            {
+                PumpHarness(harness, thinkTime(randomEngine));
+                typed += key;
+                RecordLatency(PressAndTime(harness, key, CommandLineIs(typed)), echoLatency, lostKeys);
+            }
+            PumpHarness(harness, thinkTime(randomEngine));
+            RecordLatency(PressAndTime(harness, '\n', CommandLineIs("")), enterLatency, lostKeys);
+        }
+    }
+
+    // end the game and tidy up
+    WriteAll(harness.masterFd, "\nquit\n", 6);
+    for (int attempt = 0; attempt < 50 and PumpHarness(harness, 100); attempt++)
+    {
+    }
+    int status{0};
+    if (waitpid(child, &status, WNOHANG) == 0)
+    {
+        kill(child, SIGTERM);
+        waitpid(child, &status, 0);
+    }
+    close(harness.masterFd);
+    filesystem::remove_all(scratch);
+
+    PrintPercentiles("keypress -> echo", echoLatency);
+    PrintPercentiles("last key of a word -> word cleared", clearLatency);
+    PrintPercentiles("enter -> command cleared", enterLatency);
+    cout << "lost keys: " << lostKeys << endl;
+    cout << "words that reached the edge while being typed: " << edgeLosses << endl;
+    return (started and lostKeys == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// what the program can be asked to do, for when it's asked something it can't
+auto PrintUsage(ostream &output) -> void
+{
+    output << "usage: team23-typespeed [--mode <name>] [--fps <frames a second>] [--resume [file]]" << endl
+           << "       team23-typespeed --server <port or socket path> [threads]" << endl
+           << "       team23-typespeed --compile-dictionary <word list> <output>" << endl
+           << "       team23-typespeed --replay <recording> [realtime|snapshots]" << endl
+           << "       team23-typespeed --benchmark [ticks] [seed] [mode]" << endl
+           << "       team23-typespeed --tick-scaling-benchmark [words] [threads]" << endl
+           << "       team23-typespeed --escape-benchmark [words]" << endl
+           << "       team23-typespeed --latency-benchmark [keystrokes]" << endl
+           << "       team23-typespeed --ranking-check [players] [seed]" << endl
+           << "       team23-typespeed --typing-check" << endl;
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    vector<string> arguments(argv + 1, argv + argc);
+    SetupTracing();
+    // the number at arguments[position], or fallback if there aren't that many arguments
+    auto optionalNumber{[&arguments](size_t position, auto fallback, auto &number) -> bool
+                        {
+                            number = fallback;
+                            return position >= arguments.size() or ParseNumber(arguments[position], number);
+                        }};
+    auto badArguments{[]() -> int
+                      {
+                          PrintUsage(cerr);
+                          return EXIT_FAILURE;
+                      }};
+    auto unknownMode{[](string_view name) -> int
+                     {
+                         cerr << "there's no game mode called " << name << " (try:";
+                         for (const auto &known : GAME_MODES)
+                         {
+                             cerr << " " << known.name;
+                         }
+                         cerr << ")" << endl;
+                         return EXIT_FAILURE;
+                     }};
+    // the tools each take their own arguments, in order
+    string_view command{arguments.empty() ? string_view{} : string_view{arguments[0]}};
+    if (command == "--compile-dictionary")
+    {
+        if (arguments.size() != 3)
+        {
+            return badArguments();
+        }
+        return CompileDictionary(arguments[1], arguments[2]);
+    }
+    if (command == "--server")
+    {
+        unsigned int workerCount;
+        if (arguments.size() < 2 or arguments.size() > 3 or not optionalNumber(2, thread::hardware_concurrency(), workerCount))
+        {
+            return badArguments();
+        }
+        return RunServer(arguments[1], workerCount);
+    }
+    if (command == "--benchmark")
+    {
+        unsigned long long tickCount;
+        unsigned int benchmarkSeed;
+        if (arguments.size() > 4 or not optionalNumber(1, 3000000ULL, tickCount) or not optionalNumber(2, 1U, benchmarkSeed))
+        {
+            return badArguments();
+        }
+        const gameMode *benchmarkMode{arguments.size() == 4 ? FindGameMode(arguments[3]) : &GAME_MODES[MODE_CLASSIC]};
+        if (benchmarkMode == nullptr)
+        {
+            return unknownMode(arguments[3]);
+        }
+        return RunBenchmark(tickCount, benchmarkSeed, *benchmarkMode);
+    }
+    if (command == "--tick-scaling-benchmark")
+    {
+        unsigned int wordCount;
+        unsigned int threadCount;
+        if (arguments.size() > 3 or not optionalNumber(1, 100000U, wordCount) or not optionalNumber(2, max(1U, thread::hardware_concurrency()), threadCount))
+        {
+            return badArguments();
+        }
+        return RunTickScalingBenchmark(wordCount, threadCount);
+    }
+    if (command == "--escape-benchmark")
+    {
+        unsigned long long wordCount;
+        if (arguments.size() > 2 or not optionalNumber(1, 10000000ULL, wordCount))
+        {
+            return badArguments();
+        }
+        return RunEscapeBenchmark(wordCount);
+    }
+    if (command == "--ranking-check")
+    {
+        unsigned int playerCount;
+        unsigned int checkSeed;
+        if (arguments.size() > 3 or not optionalNumber(1, 2000U, playerCount) or not optionalNumber(2, 1U, checkSeed))
+        {
+            return badArguments();
+        }
+        return RunRankingCheck(playerCount, checkSeed);
+    }
+    if (command == "--typing-check")
+    {
+        if (arguments.size() != 1)
+        {
+            return badArguments();
+        }
+        return RunTypingCheck();
+    }
+    if (command == "--latency-benchmark")
+    {
+        unsigned int keyCount;
+        if (arguments.size() > 2 or not optionalNumber(1, 500U, keyCount))
+        {
+            return badArguments();
+        }
+        return RunLatencyBenchmark(keyCount);
+    }
+    if (command == "--replay")
+    {
+        if (arguments.size() < 2 or arguments.size() > 3 or (arguments.size() == 3 and arguments[2] != "realtime" and arguments[2] != "snapshots"))
+        {
+            return badArguments();
+        }
+        return RunReplay(arguments[1], arguments.size() == 3 and arguments[2] == "realtime", arguments.size() == 3 and arguments[2] == "snapshots");
+    }
+
+    // the game itself takes any of these, in any order:
+    // --mode <name> plays one of the other game modes, --fps <frames a second> caps the redraws
+    // and --resume [file] carries on from a snapshot instead of starting a new game
+    int frameRate{DEFAULT_FRAME_RATE};
+    const gameMode *mode{&GAME_MODES[MODE_CLASSIC]};
+    bool modeChosen{false};
+    string resumeFile;
+    for (size_t position = 0; position < arguments.size(); position++)
+    {
+        string_view flag{arguments[position]};
+        bool valueFollows{position + 1 < arguments.size() and not arguments[position + 1].starts_with("--")};
+        if (flag == "--fps" and valueFollows)
+        {
+            position += 1;
+            if (not ParseNumber(arguments[position], frameRate) or frameRate <= 0)
+            {
+                return badArguments();
+            }
+        }
+        else if (flag == "--mode" and valueFollows)
+        {
+            position += 1;
+            mode = FindGameMode(arguments[position]);
+            if (mode == nullptr)
+            {
+                return unknownMode(arguments[position]);
+            }
+            modeChosen = true;
+        }
+        else if (flag == "--resume")
+        {
+            resumeFile = DEFAULT_SNAPSHOT;
+            if (valueFollows)
+            {
+                position += 1;
+                resumeFile = arguments[position];
+            }
+        }
+        else
+        {
+            return badArguments();
+        }
+    }
+    if (not resumeFile.empty() and access(resumeFile.c_str(), R_OK) < 0)
+    {
+        cerr << "there's no saved game in " << resumeFile << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Set Up the system to receive input
+    SetupScreenAndInput();
+    // Check that the terminal size is large enough for the game to be played
+    const positionStruct TERMINAL_SIZE{GetTerminalSize()};
+
+    //cerr << TERMINAL_SIZE.row << endl;
+    // check if terminal size too small; if so initiate exit
+    if ((TERMINAL_SIZE.row < BORDER_HEIGHT + ROWS_BELOW_FIELD) or (TERMINAL_SIZE.col < BORDER_WIDTH))
+    {
+        ShowCursor();
+        TeardownScreenAndInput();
+        cout << endl
+             << "Terminal window must be at least 35 by 70 to run this game" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // need to reset input to allow cin to process correctly (default input mode)
+    TeardownScreenAndInput();
     // clear screen and move cursor to top for correct menu formatting
     ClearScreen();
     MoveTo(1, 1);
@@ -534,101 +6477,214 @@ auto main() -> int
     // set up screen again to prep input mode for game
     SetupScreenAndInput();
 
-    vector<string> wordList;
-    //loads text file with a bunch of words into vector
-    LoadWordList("wordlist.txt", wordList);
+    dictionary wordList;
+    //maps the compiled word list into memory, or the text file with a bunch of words if there isn't one
+    if (not LoadCompiledWordList("wordlist.tsd", wordList) and not LoadWordList("wordlist.txt", wordList))
+    {
+        TeardownScreenAndInput();
+        cout << endl
+             << "couldn't load any words from wordlist.txt" << endl;
+        return EXIT_FAILURE;
+    }
 
     // State Variables
-    wordvector activeWords;
-    unsigned int ticks{0};
-    unsigned int score{0};
-    unsigned int lives{5};
-    bool quit{false};
-    char currentChar;
-    string currentCommand;
+    // (the session also holds the screen buffer, so only changed cells get sent)
+    auto session{make_unique<gameSession>()};
+    StartSession(*session, TERMINAL_SIZE.row, TERMINAL_SIZE.col, WORD_STORE_CAPACITY, seed, *mode);
+    if (not resumeFile.empty())
+    {
+        const char *snapshotData{nullptr};
+        size_t snapshotSize{0};
+        bool restored{MapFile(resumeFile, snapshotData, snapshotSize) and
+                      RestoreSnapshot(*session, wordList, string_view(snapshotData, snapshotSize), WORD_STORE_CAPACITY)};
+        if (snapshotData != nullptr)
+        {
+            munmap(const_cast<char *>(snapshotData), snapshotSize);
+        }
+        if (not restored)
+        {
+            TeardownScreenAndInput();
+            UnloadWordList(wordList);
+            cout << endl
+                 << resumeFile << " isn't a saved game this version (and word list) can carry on from" << endl;
+            return EXIT_FAILURE;
+        }
+        // a saved game carries on in the mode it was started in
+        if (modeChosen and session->mode != mode)
+        {
+            TeardownScreenAndInput();
+            UnloadWordList(wordList);
+            cout << endl
+                 << resumeFile << " is a " << session->mode->name << " game, it can't carry on as " << mode->name << endl;
+            return EXIT_FAILURE;
+        }
+        // the terminal may not be the size it was when the game was saved
+        if (session->screen.rows != TERMINAL_SIZE.row or session->screen.cols != TERMINAL_SIZE.col)
+        {
+            ResizeSession(*session, TERMINAL_SIZE.row, TERMINAL_SIZE.col);
+        }
+    }
+    screenBuffer &screen{session->screen};
+    // everything the game gets from outside is recorded, so the game can be replayed later
+    // (not a resumed one though, a replay has to start from the beginning)
+    sessionRecorder recorder;
+    const char *recordingName{getenv("TYPESPEED_RECORD")};
+    string recordingFile{recordingName != nullptr ? recordingName : DEFAULT_RECORDING};
+    if (not recordingFile.empty() and resumeFile.empty())
+    {
+        StartRecording(recorder, recordingFile, seed, *mode, TERMINAL_SIZE.row, TERMINAL_SIZE.col, wordList);
+    }
+    // anyone can watch when the game is broadcast
+    broadcaster spectators;
+    if (const char *broadcastAddress{getenv("TYPESPEED_BROADCAST")}; broadcastAddress != nullptr and *broadcastAddress != '\0')
+    {
+        StartBroadcast(spectators, broadcastAddress);
+    }
+    // the game is saved every few seconds (and as soon as it's paused or quit) so it can be resumed
+    string snapshotFile{resumeFile.empty() ? DEFAULT_SNAPSHOT : resumeFile};
+    string snapshot;
+    unsigned int lastSnapshotTick{session->ticks};
+    bool wasPaused{session->paused};
 
     bool allowBackgroundProcessing{true};
 
-    auto startTimestamp{chrono::steady_clock::now()};
-    auto endTimestamp{startTimestamp};
-    int elapsedTimePerTick{100}; // every 0.1s check on things
+    // the game moves on every SIMULATION_STEP_MS, the screen is redrawn at most frameRate times a second
+    auto frameInterval{chrono::nanoseconds(1000000000LL / max(frameRate, 1))};
+    tickScheduler scheduler;
+    if (not StartTickScheduler(scheduler, SIMULATION_STEP_MS))
+    {
+        TeardownScreenAndInput();
+        return EXIT_FAILURE;
+    }
 
     SetNonblockingReadState(allowBackgroundProcessing);
+    // relayout straight away when the window is resized, no restart needed
+    signal(SIGWINCH, NoteTerminalResized);
+    signal(SIGINT, NoteGameInterrupted);
+    signal(SIGTERM, NoteGameInterrupted);
     ClearScreen();
     HideCursor();
 
     // keep looping (game is active) while user hasn't typed "quit" and they haven't died
-    while ((not quit) and (lives > 0))
+    while (not SessionOver(*session))
     {
-
-        endTimestamp = chrono::steady_clock::now();
-        auto elapsed{chrono::duration_cast<chrono::milliseconds>(endTimestamp - startTimestamp).count()};
-        // We want to process input and update the world when EITHER
-        // (a) there is background processing and enough time has elapsed
-        // (b) when we are not allowing background processing.
-        if ((allowBackgroundProcessing and (elapsed >= elapsedTimePerTick)))
+        // sleep until a key is pressed or the next tick is due
+        // (or, if a frame is waiting on the frame rate cap, until it can be drawn)
+        int timeoutMs{-1};
+        if (session->dirty)
         {
-
-            ticks += 1;
-            if (ticks % 15 == 0)
-            { // only create words every 15 ticks to space them out
-                CreateWord(activeWords, wordList);
-            }
-
-            UpdateWordColumnPositions(activeWords);
-
-            if (currentChar != '\n' and read(0, &currentChar, 1) == 1) //checks if new char is added and if isn't an \n
-            {
-                currentCommand += currentChar;
-            }
-            if (currentChar == '\n') //clears currentcommand if the user enters \n
+            auto untilFrame{session->lastFrame + frameInterval - chrono::steady_clock::now()};
+            timeoutMs = max(0, static_cast<int>(chrono::ceil<chrono::milliseconds>(untilFrame).count()));
+        }
+        schedulerEvents events{false, false, 0};
+        {
+            TRACE_SCOPE("wait");
+            events = WaitForEvents(scheduler, 0, timeoutMs);
+        }
+        CheckTraceDumpRequest();
+        if (gameInterrupted.exchange(false))
+        {
+            session->quit = true;
+        }
+        if (terminalResized.exchange(false))
+        { // without the ioctl the game keeps the last size it knew rather than asking mid game
+            positionStruct newSize{ReadWindowSize()};
+            if (newSize.row > 0 and newSize.col > 0)
             {
-                // remove \n from command (has whitespace)
-                currentCommand.pop_back();
-                // check if command matched in activeWords
-                CheckMatchedWord(activeWords, currentCommand, quit);
-                //cerr << currentCommand << endl;
-                currentCommand.clear();
+                ResizeSession(*session, newSize.row, newSize.col);
+                RecordResize(recorder, newSize.row, newSize.col);
             }
+        }
 
-            // add pause logic (toggle moving)
-
-            // clear any activeWords that were matched/are past boundary
-            ClearWords(activeWords, score, lives);
+        size_t headBefore{session->input.head.load(memory_order_relaxed)};
+        if (events.inputReady and PumpInput(0, session->input) == 0)
+        { // stdin was closed, nobody is left to play
+            session->quit = true;
+        }
+        RecordInput(recorder, session->input, headBefore);
+        // handle every keystroke that has arrived, not just one per tick
+        ConsumeSessionInput(*session);
 
-            // Clear inputs in preparation for the next iteration
-            startTimestamp = endTimestamp;
-            currentChar = NULL_CHAR;
+        // run every step that's due, so the game speed doesn't depend on how often we wake up
+        for (unsigned long long step = 0; step < min<unsigned long long>(events.stepsDue, MAX_CATCH_UP_STEPS) and not SessionOver(*session); step++)
+        {
+            RunSessionTick(*session, wordList);
+            RecordTick(recorder);
+        }
+        if (not SessionOver(*session) and
+            (session->ticks - lastSnapshotTick >= SNAPSHOT_INTERVAL_STEPS or (session->paused and not wasPaused)))
+        {
+            SaveSnapshot(*session, wordList, snapshot);
+            WriteSnapshotFile(snapshotFile, snapshot);
+            lastSnapshotTick = session->ticks;
+        }
+        wasPaused = session->paused;
 
-            ClearScreen();
-            HideCursor();
-            // redisplay active words since they've been updated/cleared
-            MoveTo(0, 0);
-            border();
-            DisplayWords(activeWords);
-            // shows stats at bottom of terminal
-            MoveTo(TERMINAL_SIZE.row, 0);
-            ShowStats(score, lives);
-            // command displayed just above stats
-            MoveTo(TERMINAL_SIZE.row - 2, 1);
-            cout << "Command: " << currentCommand;
-            ShowCursor();
+        // redraw as soon as something changed so typed characters show up straight away
+        // (only cells that actually changed get sent)
+        if (FrameDue(*session, chrono::steady_clock::now(), frameInterval))
+        {
+            DrawGameFrame(*session);
+            TRACE_SCOPE("present");
+            WriteAll(1, screen.output.data(), screen.output.size());
+            PublishFrame(spectators, screen);
+        }
+        else
+        {
+            PublishKeyframe(spectators, screen);
         }
     }
+    StopTickScheduler(scheduler);
+    signal(SIGWINCH, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    StopRecording(recorder, session->score, session->lives);
+    StopBroadcast(spectators);
+    // a finished game can't be carried on, one that was quit is saved (paused) to come back to
+    bool saved{not SessionFinished(*session)};
+    if (saved)
+    {
+        session->quit = false;
+        session->paused = true;
+        SaveSnapshot(*session, wordList, snapshot);
+        saved = WriteSnapshotFile(snapshotFile, snapshot);
+        session->quit = true;
+    }
+    else
+    {
+        unlink(snapshotFile.c_str());
+    }
 
     // Tidy Up and Close Down
+    cerr << "frames: " << screen.framesPresented << " bytes written: " << screen.bytesTotal
+         << " last frame: " << screen.bytesLastFrame << " average: "
+         << (screen.framesPresented ? screen.bytesTotal / screen.framesPresented : 0) << endl;
+    PrintTickStats(cerr, scheduler);
+    FinishSessionStats(*session);
+    PrintTypingStats(cerr, processTypingStats);
     ClearScreen();
     MoveTo(0, 0); // move cursor back to top of screen
     ShowCursor();
     SetNonblockingReadState(false); // back to blocking input
     // reset input mode
     TeardownScreenAndInput();
+    UnloadWordList(wordList);
     // display game over, display/store high score list
-    ShowEndScreen(score);
-    map<string, unsigned int> highScores;
-    // loads high score file into map
-    LoadHighScores("highscores.txt", highScores);
-    ProcessHighScores("highscores.txt", highScores, userName, score);
+    ShowEndScreen(cout, session->score, SessionWordsPerMinute(*session), AccuracyPercent(session->stats));
+    // a saved game's score only goes on the table once it's finished, or it'd be there twice
+    if (saved)
+    {
+        cout << endl
+             << "your game is saved, carry on with: ./team23-typespeed --resume" << (snapshotFile == DEFAULT_SNAPSHOT ? "" : " " + snapshotFile) << endl
+             << "(the score goes on the high score table when the game ends)" << endl;
+    }
+    else
+    {
+        highScoreStore highScores;
+        // loads the high score table plus any games logged since it was last written
+        LoadHighScores(highScores, "highscores.txt", "highscores.log");
+        ProcessHighScores(cout, highScores, userName, session->score);
+    }
     cout << endl; // be nice to the next command
     return EXIT_SUCCESS;
 }
\ No newline at end of file